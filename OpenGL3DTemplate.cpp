@@ -1,11 +1,28 @@
-﻿#include "Mesh.hpp"
-#include "Model.hpp"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+﻿#include "mesh.hpp"
+#include "model.hpp"
+#include "meshcache.hpp"
+#include "texture.hpp"
+#include "assetpack.hpp"
+#include "renderqueue.hpp"
+#include "frustum.hpp"
+#include "occlusion.hpp"
+#include "segmentstream.hpp"
+#include "renderbackend.hpp"
+#include "softraster.hpp"
+#include "headless.hpp"
+#include "framepacing.hpp"
+
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 #include <glut.h>
+#include "glcalls.hpp"
 
 enum ViewMode { VIEW_FPS, VIEW_TPS };
 
@@ -20,6 +37,7 @@ float playerYaw = 0.0f; // degrees
 float playerVelY = 0.0f;
 bool  isGrounded = true;
 
+// per simulation tick at SIM_TUNED_HZ, like the other rates in simulateTick()
 const float GRAVITY = -0.3f;  // tweak
 const float JUMP_VELOCITY = 0.61f;   // tweak
 
@@ -29,6 +47,8 @@ float camPitch = 0.0f;
 
 const float MOVE_SPEED = 0.3f;
 
+// the corridor mesh's end cap is trimmed off 2 * cutDiff (local units)
+// short of its far end, so that copies placed end to end line up
 const float cutDiff = 40;
 
 // rotation for testing
@@ -38,7 +58,8 @@ float rotAng = 0.0f;
 const float PLAYER_R = 0.4f;   // collision radius
 const float CORRIDOR_HALF_WIDTH = 1.8f;   // corridor lane: x in [-1.8, 1.8]
 
-const float Z_FRONT_LIMIT = -80.0f;  // far end (more negative)
+// far end at z = -levelLength (--level-length; 0 = endless corridor)
+float levelLength = 80.0f;
 const float Z_BACK_LIMIT = 5.0f;   // behind start (positive)
 
 const float JUMP_OVER_HEIGHT = 0.4f; // if playerY >= this, crates no longer block
@@ -51,6 +72,13 @@ const float Z_MAX = 80.0f;  // far end (adjust to your scene)
 
 
 
+// mesh draws of a frame, sorted by pass / texture / mesh / depth
+RenderQueue gRenderQueue;
+GLBackend gGLBackend(gRenderQueue);
+
+// CPU time spent in Display(), smoothed; shown next to the render path
+double frameMs = 0.0;
+
 int   playerHealth = 100;
 int   playerAmmo = 30;
 int   playerScore = 0;
@@ -60,6 +88,32 @@ float gunRecoil = 0.0f;   // degrees
 float gunRecoilDecay = 0.8f;   // how fast it goes back to 0
 float muzzleFlashTime = 0.0f;   // frames or seconds, we’ll just decay it
 
+// ---------- Fixed-step simulation ----------
+//
+// Anim() advances the game in ticks of 1 / gTickRate seconds, however
+// often GLUT calls it: real time goes into an accumulator and whole ticks
+// are taken out. The per-tick rates (GRAVITY, JUMP_VELOCITY, the decays)
+// were tuned at one step per idle call, about 60 a second; a tick scales
+// them by SIM_TUNED_HZ / gTickRate so every tick rate plays the same.
+// Drawing reads gRenderState, the last two ticks blended by how far real
+// time has got into the next one.
+
+const double SIM_TUNED_HZ = 60.0;
+
+double gTickRate = 60.0;       // --tick-rate
+int gMaxTicksPerFrame = 8;     // --max-catchup: time past this many ticks is dropped
+
+// the simulated values drawing interpolates
+struct SimState {
+    float playerY = 0.0f;
+    float rotAng = 0.0f;
+    float gunRecoil = 0.0f;
+};
+
+SimState gRenderState;
+int gTicksThisFrame = 0;
+int gDroppedTicks = 0;         // since start, by the catch-up clamp
+
 // Zombie
 int   zombieHealth = 100;
 bool  zombieAlive = true;
@@ -133,41 +187,73 @@ struct GameObject {
     PickupType pickupType = PICKUP_NONE;
     bool collected = false;
 
-    void draw() const {
+    // model LOD it was last drawn at (selectLod keeps it unless clearly off)
+    mutable int lod = 0;
+
+    InstanceTransform instance() const {
+        return { x, y, z, ry, sx, sy, sz, 0.0f };
+    }
+
+    // one copy of its mesh / model placed at t (usually instance()), models
+    // at the LOD gatherScene last picked
+    void draw(RenderBackend& backend, const InstanceTransform& t) const {
         if (collected && pickupType != PICKUP_NONE) return; // don't draw collected pickups
 
-        glPushMatrix();
-        glTranslatef(x, y, z);
-        glRotatef(ry, 0, 1, 0);
-        glScalef(sx, sy, sz);
+        if (model) backend.drawModel(*model, lod, t);
+        else if (mesh) backend.drawMesh(*mesh, texId, t);
+    }
 
+    // world AABB at t: the mesh bounds, or a cube around the model's sphere
+    WorldBox worldBounds(const InstanceTransform& t) const {
+        float mn[3] = { 0, 0, 0 }, mx[3] = { 0, 0, 0 };
         if (model) {
-            model->draw();
+            float r = model->boundingRadius();
+            mn[0] = mn[1] = mn[2] = -r;
+            mx[0] = mx[1] = mx[2] = r;
         }
-        else if (mesh) {
-            if (texId) {
-                glEnable(GL_TEXTURE_2D);
-                glBindTexture(GL_TEXTURE_2D, texId);
-                glColor3f(1, 1, 1);
-                mesh->draw(true);
-                glDisable(GL_TEXTURE_2D);
-            }
-            else {
-                glDisable(GL_TEXTURE_2D);
-                glColor3f(0.7f, 0.7f, 0.7f);
-                mesh->draw(false);
-            }
+        else if (mesh && mesh->hasBounds) {
+            mn[0] = mesh->minX; mn[1] = mesh->minY; mn[2] = mesh->minZ;
+            mx[0] = mesh->maxX; mx[1] = mesh->maxY; mx[2] = mesh->maxZ;
         }
-        glPopMatrix();
+        return transformBox(mn, mx, t.x, t.y, t.z, t.ry, t.sx, t.sy, t.sz);
     }
 };
 
-std::vector<GameObject> corridorSegments;
+std::vector<GameObject> corridorSegments;   // pool, placed by gCorridorStream
 std::vector<GameObject> crates;
 std::vector<GameObject> pickups;   // health + ammo
 std::vector<GameObject> enemies;   // zombies
 GameObject playerVisual;           // for TPS soldier model
 
+// camera frustum, rebuilt by updateCamera
+Frustum gFrustum;
+
+// objects considered for drawing this frame, culled in one pass
+struct Drawable {
+    const GameObject* obj;
+    InstanceTransform t;
+    bool occluder;       // crates: drawn into gOcclusion, not tested against it
+};
+std::vector<Drawable> gDrawables;
+CullList gCullList;
+std::vector<unsigned char> gVisible;
+int gVisibleObjects = 0;
+int gCulledObjects = 0;
+
+// software depth buffer the frustum survivors are tested against
+const int OCCLUSION_WIDTH = 128;
+const int OCCLUSION_HEIGHT = 128;
+OcclusionBuffer gOcclusion;
+bool gUseOcclusion = true;       // --no-occlusion
+int gOccludedObjects = 0;
+int gLodObjects[4] = { 0, 0, 0, 0 };   // models drawn at each LOD this frame
+
+// corridor segment i sits at z = -i * step; only the ones within view
+// distance of the player exist, as the corridorSegments pool
+SegmentStreamer gCorridorStream;
+float gCorridorView = 100.0f;   // --corridor-view: how far ahead segments are kept
+float gCorridorStart = 0.0f;    // distance from a segment's z to where its kept part starts
+
 
 struct Vec3 {
     float x, y, z;
@@ -177,6 +263,16 @@ Vec3 gCamPos = { 0,0,0 };
 Vec3 gCamDir = { 0,0,-1 };
 Vec3 gCamRight = { 1,0,0 };
 Vec3 gCamUp = { 0,1,0 };
+float gProjScale = 1.0f;   // 1 / tan(fovy / 2), from the projection matrix
+
+// camera matrices (column-major), built on the CPU so the software
+// renderer sees exactly what GL is given
+const float CAMERA_FOVY = 45.0f;
+const float CAMERA_NEAR = 0.1f;
+const float CAMERA_FAR = 300.0f;
+float gViewMatrix[16];
+float gProjMatrix[16];
+float gClipMatrix[16];     // gProjMatrix * gViewMatrix
 
 Vec3 makeVec(float x, float y, float z) { return { x,y,z }; }
 Vec3 add(const Vec3& a, const Vec3& b) { return { a.x + b.x,a.y + b.y,a.z + b.z }; }
@@ -373,7 +469,7 @@ bool canMoveTo(float newX, float newZ) {
     if (newX + PLAYER_R > CORRIDOR_HALF_WIDTH) return false;
 
     // 2) corridor limits in Z
-    if (newZ - PLAYER_R < Z_FRONT_LIMIT) return false; // too far forward (-Z)
+    if (levelLength > 0 && newZ - PLAYER_R < -levelLength) return false; // too far forward (-Z)
     if (newZ + PLAYER_R > Z_BACK_LIMIT)  return false; // too far back
 
     // 3) stepping logic: compare current vs next ground height
@@ -407,56 +503,6 @@ bool canMoveTo(float newX, float newZ) {
 
 
 
-unsigned int loadTexture(const char* filename) {
-    int w, h, ch;
-    unsigned char* data = stbi_load(filename, &w, &h, &ch, 0);
-    if (!data) {
-        printf("Failed to load texture: %s\n", filename);
-        return 0;
-    }
-
-    GLenum format = GL_RGB;
-    if (ch == 4) format = GL_RGBA;
-
-    unsigned int texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format,
-        w, h, 0,
-        format, GL_UNSIGNED_BYTE, data);
-
-    // NO glGenerateMipmap here
-
-    // simple filtering (no mipmaps)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    // optional: wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-    stbi_image_free(data);
-    return texID;
-}
-
-void drawTextured(const Mesh& mesh, unsigned int texId, bool useTex = true) {
-    if (texId && useTex) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, texId);
-        glColor3f(1.0f, 1.0f, 1.0f); // so texture not tinted
-        mesh.draw(true);
-        glDisable(GL_TEXTURE_2D);
-    }
-    else {
-        glDisable(GL_TEXTURE_2D);
-        glColor3f(0.7f, 0.7f, 0.7f);
-        mesh.draw(false);
-    }
-}
-
-
-
 void movePlayer(float forwardDelta, float rightDelta) {
     float yawRad = playerYaw * 3.14159265f / 180.0f;
 
@@ -485,6 +531,21 @@ void Keyboard(unsigned char key, int x, int y) {
     case 'a': case 'A': movePlayer(0.0f, -MOVE_SPEED); break;
     case 'd': case 'D': movePlayer(0.0f, MOVE_SPEED); break;
 
+    case 'm': case 'M':
+        // cycle immediate -> display list -> VBO
+        gRenderPath = static_cast<RenderPath>((gRenderPath + 1) % (RENDER_VBO + 1));
+        frameMs = 0.0;
+        printf("Render path: %s\n", renderPathName(gRenderPath));
+        break;
+
+    case 'v': case 'V':
+        // cycle vsync -> uncapped -> target fps
+        gPresentMode = static_cast<PresentMode>((gPresentMode + 1) % (PRESENT_TARGET_FPS + 1));
+        if (!applyPresentMode() && gPresentMode != PRESENT_TARGET_FPS)
+            printf("No swap control, vsync is up to the driver\n");
+        printf("Present mode: %s\n", presentModeName(gPresentMode));
+        break;
+
     case ' ':
     if (isGrounded) {
         isGrounded = false;
@@ -598,16 +659,15 @@ void drawBetterHands() {
 }
 
 
-void applyCamera() {
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-
+// camera position and basis from the player, then the view matrix and
+// everything culling needs from it; no GL
+void updateCamera() {
     float eyeHeight = 1.6f;
 
     // choose camera position (FPS or TPS)
     if (viewMode == VIEW_FPS) {
         gCamPos.x = playerX;
-        gCamPos.y = playerY + eyeHeight;
+        gCamPos.y = gRenderState.playerY + eyeHeight;
         gCamPos.z = playerZ;
     }
     else {
@@ -619,7 +679,7 @@ void applyCamera() {
         float camHeight = 2.5f;
 
         gCamPos.x = playerX - fx * camDistBack;
-        gCamPos.y = playerY + camHeight;
+        gCamPos.y = gRenderState.playerY + camHeight;
         gCamPos.z = playerZ - fz * camDistBack;
     }
 
@@ -637,106 +697,168 @@ void applyCamera() {
     gCamRight = normalize(cross(gCamDir, worldUp));
     gCamUp = normalize(cross(gCamRight, gCamDir));
 
-    // target point for gluLookAt
-    float cx = gCamPos.x + gCamDir.x;
-    float cy = gCamPos.y + gCamDir.y;
-    float cz = gCamPos.z + gCamDir.z;
+    // target point for the look-at
+    const float eye[3] = { gCamPos.x, gCamPos.y, gCamPos.z };
+    const float center[3] = { gCamPos.x + gCamDir.x, gCamPos.y + gCamDir.y, gCamPos.z + gCamDir.z };
+    const float up[3] = { 0.0f, 1.0f, 0.0f };
+    lookAtMatrix(eye, center, up, gViewMatrix);
 
-    gluLookAt(
-        gCamPos.x, gCamPos.y, gCamPos.z,
-        cx, cy, cz,
-        0.0f, 1.0f, 0.0f
-    );
+    multiplyMatrices(gProjMatrix, gViewMatrix, gClipMatrix);
+    gFrustum = frustumFromMatrix(gClipMatrix);
+    gProjScale = gProjMatrix[5];
 }
 
+void applyCamera() {
+    updateCamera();
 
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(gViewMatrix);
+}
 
-void drawCorridorWithClip(const GameObject& c, double localCutX) {
-    glPushMatrix();
-
-    glTranslatef(c.x, c.y, c.z);
-    glRotatef(c.ry, 0, 1, 0);
-    glScalef(c.sx, c.sy, c.sz);
 
-    GLdouble eq[4] = { -1.0, 0.0, 0.0, localCutX }; // keep x <= localCutX
 
-    glEnable(GL_CLIP_PLANE0);
-    glClipPlane(GL_CLIP_PLANE0, eq);
+// re-places the corridor pool around the player; slots with nothing to
+// show (level shorter than the pool) are parked with mesh = nullptr
+void streamCorridor() {
+    gCorridorStream.update(-playerZ - gCorridorStart);
 
-    if (c.texId) {
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, c.texId);
-        glColor3f(1, 1, 1);
-        c.mesh->draw(true);
-        glDisable(GL_TEXTURE_2D);
-    }
-    else {
-        glDisable(GL_TEXTURE_2D);
-        glColor3f(0.7f, 0.7f, 0.7f);
-        c.mesh->draw(false);
+    for (size_t i = 0; i < corridorSegments.size(); ++i) {
+        int seg = gCorridorStream.slots[i];
+        corridorSegments[i].mesh = seg >= 0 ? &corridorMesh : nullptr;
+        corridorSegments[i].z = -seg * gCorridorStream.step;
     }
-
-    glDisable(GL_CLIP_PLANE0);
-    glPopMatrix();
 }
 
 
 
+// Draws the visible crates (shrunk a little, so the box stays inside the
+// model) and the corridor's side walls into gOcclusion, then drops every
+// other visible drawable whose box is hidden behind them.
+void cullOccluded() {
+    gOcclusion.begin(gClipMatrix);
 
-void Display(void) {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    for (size_t i = 0; i < gDrawables.size(); ++i) {
+        const Drawable& d = gDrawables[i];
+        if (!gVisible[i] || !d.occluder || !d.obj->mesh || !d.obj->mesh->hasBounds) continue;
 
-    // 1) World (uses camera)
-    applyCamera();
+        const Mesh& m = *d.obj->mesh;
+        float mn[3] = { m.minX, m.minY, m.minZ }, mx[3] = { m.maxX, m.maxY, m.maxZ };
+        for (int k = 0; k < 3; ++k) {
+            float c = (mn[k] + mx[k]) * 0.5f, e = (mx[k] - mn[k]) * 0.45f;
+            mn[k] = c - e;
+            mx[k] = c + e;
+        }
+        gOcclusion.addBox(mn, mx, d.t.x, d.t.y, d.t.z, d.t.ry, d.t.sx, d.t.sy, d.t.sz);
+    }
 
-    double minX = corridorMesh.minX;
-    double maxX = corridorMesh.maxX;
+    // the walls at the outside of each segment's box, so never in front
+    // of the real ones
+    for (const auto& c : corridorSegments) {
+        if (!c.mesh) continue;
+        WorldBox w = c.worldBounds(c.instance());
+        for (int side = -1; side <= 1; side += 2) {
+            float x = w.cx + side * w.ex;
+            const float wall[4][3] = {
+                { x, w.cy - w.ey, w.cz - w.ez }, { x, w.cy - w.ey, w.cz + w.ez },
+                { x, w.cy + w.ey, w.cz + w.ez }, { x, w.cy + w.ey, w.cz - w.ez }
+            };
+            gOcclusion.addQuad(wall);
+        }
+    }
 
-    // where we cut the end cap in local space
-    double cutX = maxX - cutDiff;  // or whatever margin you liked
+    for (size_t i = 0; i < gDrawables.size(); ++i) {
+        if (!gVisible[i] || gDrawables[i].occluder) continue;
+        if (!gOcclusion.boxVisible(gCullList.box(static_cast<int>(i)))) {
+            gVisible[i] = 0;
+            gOccludedObjects++;
+        }
+    }
+}
 
-    // this is the local length we KEEP (from minX up to cutX)
-    double keptLenLocal = cutX - minX;
-    for (auto& c : corridorSegments) {
-        drawCorridorWithClip(c, cutX);
+// Everything the world pass may draw this frame (gDrawables), culled
+// against the camera updateCamera built (gVisible), models given a LOD.
+void gatherScene() {
+    streamCorridor();
+
+    // gather everything that may be drawn, with the transform it is drawn at
+    gDrawables.clear();
+    for (auto& c : corridorSegments)
+        if (c.mesh) gDrawables.push_back({ &c, c.instance(), false });
+    for (auto& c : crates) gDrawables.push_back({ &c, c.instance(), true });
+
+    // enemies[0] is the zombie you fight; the rest are --crowd extras
+    for (size_t i = 0; i < enemies.size(); ++i) {
+        if (i == 0 && !zombieAlive) continue;
+        gDrawables.push_back({ &enemies[i], enemies[i].instance(), false });
     }
 
+    for (auto& p : pickups) {
+        if (p.collected || p.pickupType == PICKUP_NONE || !p.mesh) continue;
+
+        // spin + bob
+        InstanceTransform t = p.instance();
+        t.ry = gRenderState.rotAng * 50.0f;
+        t.y += 0.1f * sinf(gRenderState.rotAng * 3.0f);
+        gDrawables.push_back({ &p, t, false });
+    }
 
+    // frustum-cull their world boxes in one pass, submit what's left
+    gCullList.clear();
+    for (const auto& d : gDrawables) gCullList.add(d.obj->worldBounds(d.t));
+    gVisibleObjects = cullBoxes(gFrustum, gCullList, gVisible);
+    gCulledObjects = gCullList.size() - gVisibleObjects;
 
-    for (auto& c : crates)  c.draw();
-    if (zombieAlive && !enemies.empty()) {
-        enemies[0].draw();
+    gOccludedObjects = 0;
+    if (gUseOcclusion) {
+        cullOccluded();
+        gVisibleObjects -= gOccludedObjects;
     }
 
-    for (auto& p : pickups) {
-        if (p.collected || p.pickupType == PICKUP_NONE) continue;
+    for (int& n : gLodObjects) n = 0;
+    for (size_t i = 0; i < gDrawables.size(); ++i) {
+        const Drawable& d = gDrawables[i];
+        if (!gVisible[i] || !d.obj->model) continue;
+
+        // bounding sphere over distance, as a share of half the view height
+        float dx = d.t.x - gCamPos.x, dy = d.t.y - gCamPos.y, dz = d.t.z - gCamPos.z;
+        float dist = std::max(sqrtf(dx * dx + dy * dy + dz * dz), 0.01f);
+        float r = d.obj->model->boundingRadius() * std::max(d.t.sx, std::max(d.t.sy, d.t.sz));
+        d.obj->lod = selectLod(r * gProjScale / dist, d.obj->lod, d.obj->model->lodCount());
+        gLodObjects[std::min(d.obj->lod, 3)]++;
+    }
+}
 
-        glPushMatrix();
-        glTranslatef(p.x, p.y, p.z);
+// the world pass: what gatherScene kept, plus the soldier in TPS view
+void drawWorld(RenderBackend& backend) {
+    backend.beginFrame(gViewMatrix, gProjMatrix);
 
-        // spin + bob
-        glRotatef(rotAng * 50.0f, 0, 1, 0);
-        glTranslatef(0.0f, 0.1f * sinf(rotAng * 3.0f), 0.0f);
-
-        glScalef(p.sx, p.sy, p.sz);
-
-        if (p.mesh) {
-            if (p.texId) {
-                glEnable(GL_TEXTURE_2D);
-                glBindTexture(GL_TEXTURE_2D, p.texId);
-                glColor3f(1, 1, 1);
-                p.mesh->draw(true);
-                glDisable(GL_TEXTURE_2D);
-            }
-            else {
-                glDisable(GL_TEXTURE_2D);
-                glColor3f(0.7f, 0.7f, 0.7f);
-                p.mesh->draw(false);
-            }
-        }
-        glPopMatrix();
+    for (size_t i = 0; i < gDrawables.size(); ++i)
+        if (gVisible[i]) gDrawables[i].obj->draw(backend, gDrawables[i].t);
+
+    if (viewMode == VIEW_TPS) {
+        playerVisual.x = playerX;
+        playerVisual.y = gRenderState.playerY;
+        playerVisual.z = playerZ;
+        playerVisual.ry = playerYaw;
+        playerVisual.draw(backend, playerVisual.instance());
     }
 
+    backend.endFrame();
+}
+
+void Display(void) {
+    auto frameStart = std::chrono::steady_clock::now();
+
+    // finish a few background texture loads (bounded so big images don't hitch a frame)
+    pumpTextureUploads(gTextureUploadBudget);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // 1) World (uses camera)
+    applyCamera();
+    gatherScene();
+    drawWorld(gGLBackend);
+
 
 
 
@@ -768,15 +890,21 @@ void Display(void) {
         glLoadIdentity();
 
         glTranslatef(0.2f, -0.18f, -0.75f);
-        glRotatef(gunRecoil, 1, 0, 0);
+        glRotatef(gRenderState.gunRecoil, 1, 0, 0);
         glRotatef(180.0f, 0, 1, 0);
         glRotatef(5.0f, 0, 1, 0);
 
         drawBetterHands();
 
+        // drawn over the hands: its own flush, depth test off. The hands
+        // are placed on the GL matrix stack, so this one item (a frame)
+        // reads its modelview back
         glPushMatrix();
         glScalef(SCALE_GUN, SCALE_GUN, SCALE_GUN);
-        drawTextured(gunMesh, gunTexture);
+        float gunModelview[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, gunModelview);
+        gRenderQueue.submit(gunMesh, gunTexture, gunModelview, PASS_OVERLAY);
+        gRenderQueue.flush();
         glPopMatrix();
 
         // muzzle flash as before...
@@ -787,13 +915,8 @@ void Display(void) {
 
 
 
-    if (viewMode == VIEW_TPS) {
-        playerVisual.x = playerX;
-        playerVisual.y = playerY;
-        playerVisual.z = playerZ;
-        playerVisual.ry = playerYaw;
-        playerVisual.draw();
-    }
+    // every textured draw reported its screen size; stream mip levels to match
+    updateTextureStreaming();
 
  // --- HUD overlay ---
     glMatrixMode(GL_PROJECTION);
@@ -813,6 +936,58 @@ void Display(void) {
     glColor3f(1, 1, 1);
     drawText(0.05f, 0.95f, buf);
 
+    TextureStreamStats stream = textureStreamStats();
+    snprintf(buf, sizeof(buf), "Textures: %.1f / %.0f MB resident   %d streaming",
+        stream.residentBytes / (1024.0f * 1024.0f),
+        stream.budgetBytes / (1024.0f * 1024.0f),
+        stream.streaming);
+    drawText(0.05f, 0.90f, buf);
+
+    TextureLoadStats texStats = textureLoadStats();
+    if (texStats.queued + texStats.decoded > 0) {
+        snprintf(buf, sizeof(buf), "Loading textures: %d", texStats.queued + texStats.decoded);
+        drawText(0.05f, 0.85f, buf);
+    }
+
+    snprintf(buf, sizeof(buf), "Render: %s   %.2f ms", renderPathName(gRenderPath), frameMs);
+    drawText(0.05f, 0.80f, buf);
+
+    const RenderQueueStats& rq = gRenderQueue.lastFrame;
+    snprintf(buf, sizeof(buf), "Draws: %d (%d instanced)   state changes: %d (%d dropped)",
+        rq.items, rq.instances, rq.stateChanges, rq.redundant);
+    drawText(0.05f, 0.75f, buf);
+
+    snprintf(buf, sizeof(buf), "Culling: %d visible, %d culled, %d occluded",
+        gVisibleObjects, gCulledObjects, gOccludedObjects);
+    drawText(0.05f, 0.70f, buf);
+
+    snprintf(buf, sizeof(buf), "Corridor: %d segments pooled, %d recycled",
+        (int)corridorSegments.size(), gCorridorStream.recycled);
+    drawText(0.05f, 0.65f, buf);
+
+    snprintf(buf, sizeof(buf), "LOD: %d / %d / %d / %d models",
+        gLodObjects[0], gLodObjects[1], gLodObjects[2], gLodObjects[3]);
+    drawText(0.05f, 0.60f, buf);
+
+    GLCallStats calls = glCallStats();
+    snprintf(buf, sizeof(buf), "GL calls: %d (%d draw, %d state, %d matrix, %d vertex, %d texture)",
+        calls.total(), calls.calls[GLCALL_DRAW], calls.calls[GLCALL_STATE],
+        calls.calls[GLCALL_MATRIX], calls.calls[GLCALL_VERTEX], calls.calls[GLCALL_TEXTURE]);
+    drawText(0.05f, 0.55f, buf);
+
+    PresentStats present = presentStats();
+    if (gPresentMode == PRESENT_TARGET_FPS)
+        snprintf(buf, sizeof(buf), "Present: %.0f fps target   %.2f ms, jitter %.2f ms, max %.2f",
+            gTargetFps, present.meanMs, present.jitterMs, present.maxMs);
+    else
+        snprintf(buf, sizeof(buf), "Present: %s   %.2f ms, jitter %.2f ms, max %.2f",
+            presentModeName(gPresentMode), present.meanMs, present.jitterMs, present.maxMs);
+    drawText(0.05f, 0.50f, buf);
+
+    snprintf(buf, sizeof(buf), "Sim: %.0f Hz   %d ticks this frame, %d dropped",
+        gTickRate, gTicksThisFrame, gDroppedTicks);
+    drawText(0.05f, 0.45f, buf);
+
     glEnable(GL_DEPTH_TEST);
     // glEnable(GL_LIGHTING); // if you had it
 
@@ -823,20 +998,48 @@ void Display(void) {
 
 
 
-    glFlush();
+    // the frame's own cost, not the wait for its slot or the swap
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - frameStart).count();
+    frameMs = (frameMs == 0.0) ? ms : frameMs * 0.95 + ms * 0.05;
+
+    presentFrame();
+    gRenderQueue.endFrame();
+    glCallsEndFrame();
 }
 
+// what GLUT does without a reshape callback, plus the viewport height the
+// texture streamer measures on-screen sizes in
+void Reshape(int width, int height) {
+    glViewport(0, 0, width, height);
+    gGLBackend.viewportHeight = height;
+}
+
+
+SimState currentSimState() {
+    SimState s;
+    s.playerY = playerY;
+    s.rotAng = rotAng;
+    s.gunRecoil = gunRecoil;
+    return s;
+}
+
+// one tick of 1 / gTickRate seconds
+void simulateTick() {
+    // this tick's length in ticks of the rate the constants were tuned at
+    float k = static_cast<float>(SIM_TUNED_HZ / gTickRate);
 
-void Anim() {
     // other stuff like rotAng, animations...
-    rotAng += 0.01f;
+    rotAng += 0.01f * k;
 
     // --- vertical motion ---
     float groundY = getGroundHeightAt(playerX, playerZ);
 
     if (!isGrounded) {
-        playerY += playerVelY;
-        playerVelY += GRAVITY;
+        // the arc the tuned step (y += v; v += g) traces, exactly, so the
+        // jump is the same at any tick rate
+        playerY += playerVelY * k + GRAVITY * k * (k - 1.0f) * 0.5f;
+        playerVelY += GRAVITY * k;
 
         // did we hit the ground (floor or crate top)?
         if (playerY <= groundY) {
@@ -881,18 +1084,18 @@ void Anim() {
 
     // recoil decay
     if (gunRecoil > 0.0f) {
-        gunRecoil *= gunRecoilDecay;   // exponential decay
+        gunRecoil *= powf(gunRecoilDecay, k);   // exponential decay
         if (gunRecoil < 0.1f) gunRecoil = 0.0f;
     }
 
     // muzzle flash time decay
     if (muzzleFlashTime > 0.0f) {
-        muzzleFlashTime -= 0.02f;  // tweak based on your frame rate
+        muzzleFlashTime -= 0.02f * k;  // tweak
         if (muzzleFlashTime < 0.0f) muzzleFlashTime = 0.0f;
     }
 
     if (bulletRayTime > 0.0f) {
-        bulletRayTime -= 0.02f;  // tweak
+        bulletRayTime -= 0.02f * k;  // tweak
         if (bulletRayTime <= 0.0f) {
             bulletRayTime = 0.0f;
             showBulletRay = false;
@@ -900,63 +1103,73 @@ void Anim() {
     }
 
     showBulletRay = true; // for temporary debug: always true
+}
 
+SimState gSimPrevious;            // before the last tick
+double gSimAccumulator = 0.0;     // seconds not simulated yet
 
+// Starts the clock from the current state: nothing to catch up on and
+// nothing to blend from.
+void resetSimulation() {
+    gSimPrevious = gRenderState = currentSimState();
+    gSimAccumulator = 0.0;
+}
 
-    // draw bullet ray if active
-    if (showBulletRay && bulletRayTime > 0.0f) {
-        glDisable(GL_LIGHTING);
-        glDisable(GL_TEXTURE_2D);
-
-        glLineWidth(3.0f);
-        glColor3f(1.0f, 0.9f, 0.3f);   // same color as muzzle flash
-
-        glBegin(GL_LINES);
-        glVertex3f(bulletStart.x , bulletStart.y, bulletStart.z);
-        glVertex3f(bulletEnd.x, bulletEnd.y, bulletEnd.z);
-        glEnd();
-
-        glColor3f(1, 1, 1);
-        // glEnable(GL_LIGHTING); // if you had it enabled
+// Runs the ticks `seconds` more of real time add up to, at most
+// gMaxTicksPerFrame of them (after a stall, or when ticks cost more than
+// they cover, the game slows down rather than falling further behind),
+// then blends gRenderState.
+void advanceSimulation(double seconds) {
+    double tick = 1.0 / gTickRate;
+    gSimAccumulator += seconds;
+
+    gTicksThisFrame = 0;
+    while (gSimAccumulator >= tick) {
+        if (gTicksThisFrame == gMaxTicksPerFrame) {
+            int behind = static_cast<int>(gSimAccumulator / tick);
+            gDroppedTicks += behind;
+            gSimAccumulator -= behind * tick;
+            break;
+        }
+        gSimPrevious = currentSimState();
+        simulateTick();
+        gSimAccumulator -= tick;
+        ++gTicksThisFrame;
     }
 
-
-    glutPostRedisplay();
+    float alpha = static_cast<float>(gSimAccumulator / tick);
+    SimState current = currentSimState();
+    gRenderState.playerY = gSimPrevious.playerY + (current.playerY - gSimPrevious.playerY) * alpha;
+    gRenderState.rotAng = gSimPrevious.rotAng + (current.rotAng - gSimPrevious.rotAng) * alpha;
+    gRenderState.gunRecoil = gSimPrevious.gunRecoil + (current.gunRecoil - gSimPrevious.gunRecoil) * alpha;
 }
 
+std::chrono::steady_clock::time_point gLastAnim;
 
+void Anim() {
+    auto now = std::chrono::steady_clock::now();
+    if (gLastAnim == std::chrono::steady_clock::time_point()) resetSimulation();
+    else advanceSimulation(std::chrono::duration<double>(now - gLastAnim).count());
+    gLastAnim = now;
+
+    // everything is drawn in Display (the bullet ray too), so it lands in
+    // the back buffer and goes through presentFrame's pacing
+    if (gGLUTWindow) glutPostRedisplay();
+}
 
-void main(int argc, char** argv) {
-    glutInit(&argc, argv);
-
-    glutInitWindowSize(300, 300);
-    glutInitWindowPosition(150, 150);
-
-    glutCreateWindow("OpenGL - 3D Template");
-    glutDisplayFunc(Display);
-    glutIdleFunc(Anim);
-
-    glutInitDisplayMode(GLUT_SINGLE | GLUT_RGB | GLUT_DEPTH);
-    glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
-
-    glEnable(GL_DEPTH_TEST);
-    /*glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
-    glEnable(GL_NORMALIZE);*/
-
-    GLfloat lightPos[] = { 0.0f, 5.0f, 5.0f, 1.0f };
-    glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
 
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0f, 300.0f / 300.0f, 0.1f, 300.0f);
+// Meshes, textures and models, from the asset pack at packPath if it opens
+// ("" = loose files only). Textures go to GL unless gTexturesOnGL is off.
+void loadAssets(const std::string& packPath) {
+    // time asset loading so cold (text parse) vs warm (cooked cache) starts can be compared
+    auto loadStart = std::chrono::steady_clock::now();
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(0.0f, 2.0f, 5.0f,
-        0.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f);
+    if (!packPath.empty() && openAssetPack(packPath)) {
+        AssetPackStats pack = assetPackStats();
+        printf("Using asset pack %s (%d entries, %.1f MB)\n",
+            packPath.c_str(), pack.entries, pack.bytes / (1024.0 * 1024.0));
+    }
 
     // load meshes
     gunMesh = loadOBJ("assets/AR/source/083412fa5dba4c75a3bdc3bc77dd0ed5/Gun.obj");
@@ -968,31 +1181,48 @@ void main(int argc, char** argv) {
 
 
 
-    // load textures
-    gunTexture = loadTexture("assets/AR/textures/GAP_Examen_Gun_albedo_DriesDeryckere.tga.png");
-    crateTexture = loadTexture("assets/gart130-crate/textures/L_Crate.2fbx_lambert5_BaseColor.png");
-    healthTexture = loadTexture("assets/health-pack/textures/Healthpack Textured_Albedo.png");
-    ammoTexture = loadTexture("assets/sci-fi-ammo-box/textures/BOX_full_albedo.png");
-    corridorTexture = loadTexture("assets/sci-fi-corridor-texturing-challenge/textures/scene_1001_BaseColor.png");
+    // load textures (decoded on worker threads, uploaded a few per frame by Display)
+    gunTexture = acquireTexture("assets/AR/textures/GAP_Examen_Gun_albedo_DriesDeryckere.tga.png");
+    crateTexture = acquireTexture("assets/gart130-crate/textures/L_Crate.2fbx_lambert5_BaseColor.png");
+    healthTexture = acquireTexture("assets/health-pack/textures/Healthpack Textured_Albedo.png");
+    ammoTexture = acquireTexture("assets/sci-fi-ammo-box/textures/BOX_full_albedo.png");
+    corridorTexture = acquireTexture("assets/sci-fi-corridor-texturing-challenge/textures/scene_1001_BaseColor.png");
 
     soldierModel = loadOBJWithMTL(
         "assets/Soldier/Soldier.obj",          // adjust to your real path
-        "assets/Soldier"                       // base dir where Soldier.mtl + _Body_Low.png live
+        "assets/Soldier",                      // base dir where Soldier.mtl + _Body_Low.png live
+        LOAD_OPTIMIZE | LOAD_LODS              // character meshes: reorder for vertex cache / overdraw, build LODs
     );
 
     playerModel = loadOBJWithMTL(
         "assets/military-man-army-man-soldier/source/Army man/Army man.obj",
-        "assets/military-man-army-man-soldier/source/Army man"
+        "assets/military-man-army-man-soldier/source/Army man",
+        LOAD_OPTIMIZE | LOAD_LODS
     );
 
     zombieModel = loadOBJWithMTL(
         "assets/zombie/source/obj/obj/Zombie001.obj",
-        "assets/zombie/source/obj/obj"
+        "assets/zombie/source/obj/obj",
+        LOAD_OPTIMIZE | LOAD_LODS
     );
 
+    {
+        double loadMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - loadStart).count();
+        printf("Assets loaded in %.1f ms (%s start: %d cooked hits, %d misses, %d written)\n",
+            loadMs,
+            gCookedCacheStats.misses == 0 ? "warm" : "cold",
+            gCookedCacheStats.hits, gCookedCacheStats.misses,
+            gCookedCacheStats.writes);
+
+        TextureCacheStats tex = textureCacheStats();
+        printf("Textures: %d unique, %d shared loads skipped\n", tex.misses, tex.hits);
+    }
+}
 
-    
-
+// Crates, pickups, zombies (plus `crowd` extras), the TPS soldier, the
+// colliders and the corridor pool; after loadAssets.
+void setupScene(int crowd) {
     // Gate at end of corridor, ~25 units away
    /* gateObj = {
         0.0f, 0.0f, -25.0f,
@@ -1089,6 +1319,20 @@ void main(int argc, char** argv) {
         0
         });
 
+    // --crowd: a grid of extra zombies filling the corridor, only drawn
+    for (int i = 0; i < crowd; ++i) {
+        const int perRow = 8;
+        float x = -1.4f + 2.8f * (i % perRow) / (perRow - 1);
+        float z = -20.0f - 0.8f * (i / perRow);
+        enemies.push_back({
+            x, 0.0f, z,
+            SCALE_ZOMBIE, SCALE_ZOMBIE, SCALE_ZOMBIE,
+            180.0f,
+            nullptr, &zombieModel,
+            0
+            });
+    }
+
     // TPS player visual
     playerVisual = {
         playerX, playerY, playerZ,
@@ -1129,17 +1373,33 @@ void main(int argc, char** argv) {
     double maxX = corridorMesh.maxX;
 
     // where we cut the end cap in local space
-    double cutX = maxX - 2*cutDiff;  // or whatever margin you liked
+    double cutX = maxX - 2*cutDiff;
 
     // this is the local length we KEEP (from minX up to cutX)
     double keptLenLocal = cutX - minX;
 
+    // cut it off once here rather than with a clip plane every draw; the
+    // trimmed mesh ends exactly at cutX, so segments stepped by the kept
+    // length meet without overlap
+    const float keepBeforeCut[4] = { -1.0f, 0.0f, 0.0f, (float)cutX };  // x <= cutX
+    int split = corridorMesh.clipToPlane(keepBeforeCut);
+    printf("Corridor trimmed at x = %.1f: %d triangles split, %d left\n",
+        cutX, split, corridorMesh.triangleCount());
+
 
     float stepWorld = (float)(keptLenLocal * SCALE_CORRIDOR);  // distance between segments in world
 
-    // base segment (rotated so the long X axis becomes Z)
+    // base segment (rotated so the long X axis becomes Z); ry = 90 maps
+    // local +X to world -Z, so its kept part spans -z in [minX, cutX] * scale
     corridorSegments.clear();
 
+    // no corridor.obj, or nothing left after the trim: nothing to stream
+    if (!corridorMesh.hasBounds || corridorMesh.triangleCount() == 0 || stepWorld <= 0.0f) {
+        gCorridorStream.reset(0.0f, 0.0f, 0.0f, 0, 0.0f);
+        printf("Corridor: no segments (mesh missing or empty)\n");
+        return;
+    }
+
     // base segment
     GameObject c0;
     c0.x = -0.2f;
@@ -1153,19 +1413,376 @@ void main(int argc, char** argv) {
     c0.model = nullptr;
     c0.texId = corridorTexture;
 
-    corridorSegments.push_back(c0);
+    // enough segments to reach the far end; one behind the camera as the TPS
+    // view looks back past the start
+    gCorridorStart = (float)(minX * SCALE_CORRIDOR);
+    int levelSegments = 0;
+    if (levelLength > 0)
+        levelSegments = (int)ceil((levelLength - gCorridorStart) / stepWorld);
+    gCorridorStream.reset(stepWorld, gCorridorView, stepWorld, levelSegments,
+        -playerZ - gCorridorStart);
+
+    corridorSegments.assign(gCorridorStream.slots.size(), c0);
+    streamCorridor();
+    printf("Corridor: %d segments of %.1f, %d pooled\n",
+        levelSegments, stepWorld, (int)corridorSegments.size());
+}
+
+// ---------- Benchmark helpers ----------
+
+// where the benchmark walk is on this frame: MOVE_SPEED a frame down the
+// corridor, back to the start at the far end
+float benchmarkWalkZ(int frame) {
+    float travel = levelLength > 0.0f ? std::max(levelLength - 2.0f, MOVE_SPEED) : 1000.0f;
+    return -fmodf(frame * MOVE_SPEED, travel);
+}
+
+// "mean 1.23 ms, p50 1.10, p99 2.40, max 2.50", for every mode that times frames
+std::string summarizeFrameTimes(std::vector<double> times) {
+    if (times.empty()) return "no frames";
+
+    double total = 0.0;
+    for (double t : times) total += t;
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    size_t p99 = std::min(n - 1, n * 99 / 100);
+
+    char text[128];
+    snprintf(text, sizeof(text), "mean %.2f ms, p50 %.2f, p99 %.2f, max %.2f",
+        total / n, times[n / 2], times[p99], times.back());
+    return text;
+}
+
+// --soft-render: the world pass drawn by SoftwareBackend, no window or GL
+// context. The player walks down the corridor at MOVE_SPEED a frame (back
+// to the start at the far end), so a run draws the same frames every time
+// and the image hashes can be compared across machines and thread counts.
+// The first frame also decodes every texture it meets. False if the image
+// couldn't be written.
+bool runSoftwareRender(int frames, int width, int height, int threads,
+    const std::string& outPath) {
+    SoftwareBackend soft;
+    soft.raster.resize(width, height, threads);
+
+    std::vector<double> times;
+    unsigned long long runHash = 1469598103934665603ull;
+    SoftRasterStats stats;
+
+    for (int f = 0; f < frames; ++f) {
+        playerZ = benchmarkWalkZ(f);
+        rotAng = f * 0.01f;
+        resetSimulation();
+
+        auto start = std::chrono::steady_clock::now();
+        updateCamera();
+        gatherScene();
+        drawWorld(soft);
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+
+        runHash = (runHash ^ soft.raster.target.hash()) * 1099511628211ull;
+        stats = soft.raster.stats;
+    }
+    if (times.empty()) return true;
+
+    printf("Software render: %d frames at %dx%d on %d threads: %s\n",
+        frames, width, height, soft.raster.threadCount(), summarizeFrameTimes(times).c_str());
+    printf("  last frame: %d triangles, %d rasterized, %d tile bins, %d visible objects\n",
+        stats.triangles, stats.rasterized, stats.binned, gVisibleObjects);
+    printf("  image hash: last frame %016llx, whole run %016llx\n",
+        soft.raster.target.hash(), runHash);
+
+    if (!outPath.empty()) {
+        if (!soft.raster.target.writePPM(outPath)) {
+            printf("  could not write %s\n", outPath.c_str());
+            return false;
+        }
+        printf("  wrote %s\n", outPath.c_str());
+    }
+    return true;
+}
+
+// finishes every queued texture load, whatever the upload budget
+void waitForTextureLoads() {
+    for (;;) {
+        pumpTextureUploads(gTextureUploadBudget);
+        TextureLoadStats t = textureLoadStats();
+        if (t.queued + t.decoded == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// --bench-gl: the game's own frame (a simulation tick + Display, finished
+// with glFinish) for a fixed number of frames, walking down the corridor
+// the way --soft-render does so runs match frame for frame. Every texture is
+// loaded before the first timed frame. With --fps the frame limiter runs
+// too and the times include its waits.
+void runGLBenchmark(int frames, int width, int height) {
+    waitForTextureLoads();
+
+    std::vector<double> times;
+    resetSimulation();
+    for (int f = 0; f < frames; ++f) {
+        playerZ = benchmarkWalkZ(f);
+
+        auto start = std::chrono::steady_clock::now();
+        advanceSimulation(1.0 / gTickRate);
+        Display();
+        glFinish();
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    if (times.empty()) return;
+
+    printf("GL benchmark: %d frames at %dx%d on %s (%s): %s\n",
+        frames, width, height, (const char*)glGetString(GL_RENDERER), renderPathName(gRenderPath),
+        summarizeFrameTimes(times).c_str());
+
+    GLCallStats calls = glCallStats();
+    const RenderQueueStats& rq = gRenderQueue.lastFrame;
+    printf("  last frame: %d GL calls, %d draws (%d instanced), %d visible objects\n",
+        calls.total(), rq.items, rq.instances, gVisibleObjects);
+    if (gPresentMode == PRESENT_TARGET_FPS) {
+        PresentStats present = presentStats();
+        printf("  present at %.0f fps: %.2f ms, jitter %.2f ms, max %.2f (last %d frames)\n",
+            gTargetFps, present.meanMs, present.jitterMs, present.maxMs, present.frames);
+    }
+    printf("  last frame hash %016llx\n", hashGLFramebuffer(width, height));
+}
+
+// --gl-replay: plays a log written with --gl-record into this window's
+// context and reports what the frames cost there. Frame 1 of a log also
+// holds every load-time upload, so it is left out of the call counts.
+// False on a bad log or one without frames.
+bool runGLReplay(const std::string& path) {
+    GLReplayStats replay;
+    if (!replayGLLog(path, replay)) return false;
+    if (replay.frameMs.empty()) {
+        printf("GL replay: %s has no frames\n", path.c_str());
+        return false;
+    }
+
+    int frames = replay.frames;
+    printf("GL replay of %s on %s: %d frames, %d calls\n", path.c_str(),
+        (const char*)glGetString(GL_RENDERER), frames, replay.commands);
+    printf("  submit: %s\n", summarizeFrameTimes(replay.submitMs).c_str());
+    printf("  frame:  %s\n", summarizeFrameTimes(replay.frameMs).c_str());
+    if (frames > 1) {
+        printf("  calls per frame after the first:");
+        for (int c = 0; c < GLCALL_CATEGORIES; ++c)
+            printf(" %s %.0f", glCallCategoryName(c), replay.calls.calls[c] / double(frames - 1));
+        printf("\n");
+    }
+    printf("  last frame hash %016llx\n", replay.lastFrameHash);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // --tex-budget-kb N   : texture bytes uploaded per frame while streaming in
+    // --tex-resident-mb N  : mip levels kept resident across all textures
+    // --pack FILE          : asset pack to load from (default assets.pak)
+    // --build-pack FILE    : load everything from loose files, write the pack, exit
+    // --render MODE        : immediate | list | vbo (default vbo; 'm' cycles in game)
+    // --no-instancing      : draw crates / pickups / zombies one by one
+    // --no-lod             : draw characters at full detail at any distance
+    // --no-occlusion       : frustum culling only
+    // --crowd N            : N extra zombies along the corridor (draw benchmark)
+    // --level-length M     : corridor length in world units (default 80, 0 = endless)
+    // --corridor-view M    : corridor kept this far ahead of the player (default 100)
+    // --bench-occlusion N  : time the software occlusion culler on a made-up
+    //                        corridor for N frames and exit; needs no window
+    // --soft-render N      : draw N frames with the software rasterizer, no
+    //                        window, print frame times and image hashes, exit
+    // --soft-size WxH      : its framebuffer (default 300x300, the window's)
+    // --soft-threads N     : its rasterizer threads (default one per core)
+    // --soft-out FILE      : write its last frame as a .ppm
+    // --gl-record FILE     : log every GL call from context creation on
+    // --gl-record-frames N : frames to record (default 1; loading is in frame 1)
+    // --gl-replay FILE     : play a recorded log in the window, print timings, exit
+    // --bench-gl N         : run N frames of the GL renderer offscreen, print
+    //                        frame times (mean / p50 / p99 / max), exit
+    // --present MODE       : vsync | uncapped | fps (default vsync; 'v' cycles in game)
+    // --fps N              : frame limiter target, sets --present fps (default 60)
+    // --tick-rate HZ       : simulation ticks per second (default 60)
+    // --max-catchup N      : most ticks run per frame to catch up (default 8)
+    // --offscreen          : an offscreen EGL context instead of the window
+    //                        (Mesa llvmpipe without a GPU); implied by --bench-gl
+    std::string packPath = "assets.pak";
+    std::string buildPackPath;
+    int crowd = 0;
+    int benchOcclusionFrames = 0;
+    int softFrames = 0, softWidth = 300, softHeight = 300, softThreads = 0;
+    std::string softOut;
+    std::string glRecordPath, glReplayPath;
+    int glRecordFrames = 1;
+    int benchGLFrames = 0;
+    bool offscreen = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+        if (strcmp(argv[i], "--tex-budget-kb") == 0)
+            gTextureUploadBudget = static_cast<size_t>(atoi(value)) * 1024;
+        else if (strcmp(argv[i], "--tex-resident-mb") == 0)
+            gTextureResidentBudget = static_cast<size_t>(atoi(value)) * 1024 * 1024;
+        else if (strcmp(argv[i], "--pack") == 0)
+            packPath = value;
+        else if (strcmp(argv[i], "--build-pack") == 0)
+            buildPackPath = value;
+        else if (strcmp(argv[i], "--render") == 0 && !parseRenderPath(value, gRenderPath))
+            printf("Unknown render path '%s', using %s\n", value, renderPathName(gRenderPath));
+        else if (strcmp(argv[i], "--no-instancing") == 0)
+            gUseInstancing = false;
+        else if (strcmp(argv[i], "--no-lod") == 0)
+            gUseLod = false;
+        else if (strcmp(argv[i], "--no-occlusion") == 0)
+            gUseOcclusion = false;
+        else if (strcmp(argv[i], "--crowd") == 0)
+            crowd = atoi(value);
+        else if (strcmp(argv[i], "--level-length") == 0)
+            levelLength = static_cast<float>(atof(value));
+        else if (strcmp(argv[i], "--corridor-view") == 0)
+            gCorridorView = static_cast<float>(atof(value));
+        else if (strcmp(argv[i], "--bench-occlusion") == 0)
+            benchOcclusionFrames = atoi(value);
+        else if (strcmp(argv[i], "--soft-render") == 0)
+            softFrames = atoi(value);
+        else if (strcmp(argv[i], "--soft-size") == 0 &&
+            sscanf(value, "%dx%d", &softWidth, &softHeight) != 2)
+            printf("Bad --soft-size '%s', expected WxH\n", value);
+        else if (strcmp(argv[i], "--soft-threads") == 0)
+            softThreads = atoi(value);
+        else if (strcmp(argv[i], "--soft-out") == 0)
+            softOut = value;
+        else if (strcmp(argv[i], "--gl-record") == 0)
+            glRecordPath = value;
+        else if (strcmp(argv[i], "--gl-record-frames") == 0)
+            glRecordFrames = atoi(value);
+        else if (strcmp(argv[i], "--gl-replay") == 0)
+            glReplayPath = value;
+        else if (strcmp(argv[i], "--bench-gl") == 0)
+            benchGLFrames = atoi(value);
+        else if (strcmp(argv[i], "--offscreen") == 0)
+            offscreen = true;
+        else if (strcmp(argv[i], "--tick-rate") == 0)
+            gTickRate = std::max(atof(value), 1.0);
+        else if (strcmp(argv[i], "--max-catchup") == 0)
+            gMaxTicksPerFrame = std::max(atoi(value), 1);
+        else if (strcmp(argv[i], "--present") == 0 && !parsePresentMode(value, gPresentMode))
+            printf("Unknown present mode '%s', using %s\n", value, presentModeName(gPresentMode));
+        else if (strcmp(argv[i], "--fps") == 0) {
+            gTargetFps = atof(value);
+            gPresentMode = PRESENT_TARGET_FPS;
+        }
+    }
+
+    if (benchOcclusionFrames > 0) {
+        benchmarkOcclusion(benchOcclusionFrames, OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+        return 0;
+    }
+    gOcclusion.resize(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+
+    if (softFrames > 0) {
+        softWidth = std::max(softWidth, 1);
+        softHeight = std::max(softHeight, 1);
+        perspectiveMatrix(CAMERA_FOVY, (float)softWidth / softHeight, CAMERA_NEAR, CAMERA_FAR,
+            gProjMatrix);
+
+        gTexturesOnGL = false;
+        loadAssets(packPath);
+        setupScene(crowd);
+        return runSoftwareRender(softFrames, softWidth, softHeight, softThreads, softOut) ? 0 : 1;
+    }
 
-    // second and third segments, using kept length as step
-    for (int i = 1; i < 3; ++i) {
-        GameObject ci = c0;
-        ci.z = -i * stepWorld;     // minus because corridor goes “forward” in -Z for you
-        corridorSegments.push_back(ci);
+    if (offscreen && benchGLFrames <= 0 && glReplayPath.empty()) {
+        printf("--offscreen needs --bench-gl or --gl-replay\n");
+        return 1;
     }
+    if (benchGLFrames > 0 || offscreen) {
+        // Display() and everything under it run as in the window
+        if (!createHeadlessContext(300, 300))
+            return 1;
+        gGLUTWindow = false;
+        gGLBackend.viewportHeight = 300;
+    }
+    else {
+        glutInit(&argc, argv);
+
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(300, 300);
+        glutInitWindowPosition(150, 150);
+
+        glutCreateWindow("OpenGL - 3D Template");
+        glutDisplayFunc(Display);
+        glutReshapeFunc(Reshape);
+        glutIdleFunc(Anim);
+
+        if (!applyPresentMode() && gPresentMode != PRESENT_TARGET_FPS)
+            printf("No swap control, vsync is up to the driver\n");
+    }
+
+    // before anything touches GL, so the log has every resource later
+    // frames use
+    if (!glRecordPath.empty() &&
+        !startGLRecording(glRecordPath, glRecordFrames, 300, 300)) {
+        printf("Could not create GL log %s\n", glRecordPath.c_str());
+        return 1;
+    }
+
+    // meshes upload into buffer objects at load time when the driver has them
+    if (!loadGLBufferFunctions())
+        printf("No vertex buffer objects, drawing from client-side arrays\n");
+    else if (!loadInstancingFunctions())
+        printf("No instanced drawing, repeated objects are drawn one by one\n");
 
+    if (!glReplayPath.empty())
+        return runGLReplay(glReplayPath) ? 0 : 1;
+
+    glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
+
+    glEnable(GL_DEPTH_TEST);
+    /*glEnable(GL_LIGHTING);
+    glEnable(GL_LIGHT0);
+    glEnable(GL_NORMALIZE);*/
+
+    GLfloat lightPos[] = { 0.0f, 5.0f, 5.0f, 1.0f };
+    glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
+
+
+    glMatrixMode(GL_PROJECTION);
+    perspectiveMatrix(CAMERA_FOVY, 300.0f / 300.0f, CAMERA_NEAR, CAMERA_FAR, gProjMatrix);
+    glLoadMatrixf(gProjMatrix);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gluLookAt(0.0f, 2.0f, 5.0f,
+        0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f);
+
+    loadAssets(buildPackPath.empty() ? packPath : "");
+
+    if (!buildPackPath.empty()) {
+        // textures are cooked by the workers; wait for all of them
+        waitForTextureLoads();
+
+        std::vector<std::string> files = cookedFilesUsed();
+        if (!writeAssetPack(buildPackPath, files)) {
+            printf("Could not write asset pack %s\n", buildPackPath.c_str());
+            return 1;
+        }
+        printf("Wrote asset pack %s with %d files\n", buildPackPath.c_str(), (int)files.size());
+        return 0;
+    }
+
+    setupScene(crowd);
+
+    if (benchGLFrames > 0) {
+        runGLBenchmark(benchGLFrames, 300, 300);
+        return 0;
+    }
 
     glutKeyboardFunc(Keyboard);
     glutMouseFunc(Mouse);
     glutSpecialFunc(SpecialKeys);
 
     glutMainLoop();
+    return 0;
 }
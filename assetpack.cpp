@@ -0,0 +1,248 @@
+// assetpack.cpp
+#include "assetpack.hpp"
+#include "objparse.hpp"   // MappedFile
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+static const char PACK_MAGIC[4] = { 'D', 'P', 'A', 'K' };
+static const unsigned long long PACK_ALIGN = 16;
+
+struct PackEntry {
+    unsigned long long offset = 0;
+    unsigned long long size = 0;
+};
+
+struct AssetPack {
+    MappedFile file;
+    std::unordered_map<std::string, PackEntry> toc;
+};
+
+// heap-allocated on purpose, see openAssetPack in the header
+static AssetPack* gPack = nullptr;
+static std::atomic<int> gPackHits(0);
+
+// ---------- Paths ----------
+
+std::string normalizeAssetPath(const std::string& path) {
+    std::vector<std::string> parts;
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+    size_t i = 0;
+    while (i <= path.size()) {
+        size_t j = path.find_first_of("/\\", i);
+        if (j == std::string::npos) j = path.size();
+        std::string part = path.substr(i, j - i);
+        i = j + 1;
+
+        if (part.empty() || part == ".") continue;
+        if (part == ".." && !parts.empty() && parts.back() != "..") {
+            parts.pop_back();
+            continue;
+        }
+        parts.push_back(part);
+    }
+
+    std::string key = absolute ? "/" : "";
+    for (size_t p = 0; p < parts.size(); ++p) {
+        if (p) key += '/';
+        key += parts[p];
+    }
+
+#ifdef _WIN32
+    // NTFS paths are case-insensitive
+    for (auto& c : key) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+#endif
+    return key;
+}
+
+// TOC keys ignore case everywhere, so a pack built on Linux works on Windows
+static std::string packKey(const std::string& path) {
+    std::string key = normalizeAssetPath(path);
+    for (auto& c : key) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return key;
+}
+
+// ---------- Writing ----------
+
+template <typename T>
+static void writePod(FILE* f, const T& v) {
+    std::fwrite(&v, sizeof(T), 1, f);
+}
+
+static bool copyFileInto(FILE* out, const std::string& path,
+    unsigned long long& size) {
+    FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+
+    size = 0;
+    unsigned char buf[64 * 1024];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), in)) > 0) {
+        std::fwrite(buf, 1, n, out);
+        size += n;
+    }
+    bool ok = !std::ferror(in);
+    std::fclose(in);
+    return ok;
+}
+
+bool writeAssetPack(const std::string& packPath,
+    const std::vector<std::string>& files) {
+    std::string tmp = packPath + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+
+    // header; tocOffset is patched at the end
+    std::fwrite(PACK_MAGIC, 1, 4, f);
+    writePod(f, ASSET_PACK_VERSION);
+    writePod(f, static_cast<unsigned int>(0));
+    writePod(f, static_cast<unsigned long long>(0));
+
+    struct Written {
+        std::string key;
+        PackEntry entry;
+    };
+    std::vector<Written> written;
+    unsigned long long pos = 4 + 4 + 4 + 8;
+
+    for (const auto& path : files) {
+        // pad to the entry alignment
+        while (pos % PACK_ALIGN) {
+            std::fputc(0, f);
+            ++pos;
+        }
+
+        Written w;
+        w.key = packKey(path);
+        w.entry.offset = pos;
+        if (!copyFileInto(f, path, w.entry.size)) {
+            std::cerr << "Pack: could not read " << path << "\n";
+            std::fclose(f);
+            std::remove(tmp.c_str());
+            return false;
+        }
+        pos += w.entry.size;
+        written.push_back(w);
+    }
+
+    unsigned long long tocOffset = pos;
+    for (const auto& w : written) {
+        writePod(f, static_cast<unsigned int>(w.key.size()));
+        std::fwrite(w.key.data(), 1, w.key.size(), f);
+        writePod(f, w.entry.offset);
+        writePod(f, w.entry.size);
+    }
+
+    std::fseek(f, 8, SEEK_SET);
+    writePod(f, static_cast<unsigned int>(written.size()));
+    writePod(f, tocOffset);
+
+    bool ok = !std::ferror(f);
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    std::remove(packPath.c_str());
+    if (std::rename(tmp.c_str(), packPath.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// ---------- Reading ----------
+
+template <typename T>
+static bool readPod(const unsigned char*& p, const unsigned char* end, T& v) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+    std::memcpy(&v, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool openAssetPack(const std::string& packPath) {
+    AssetPack* pack = new AssetPack();
+    if (!pack->file.open(packPath) || pack->file.size < 20) {
+        delete pack;
+        return false;
+    }
+
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(pack->file.data);
+    const unsigned char* end = base + pack->file.size;
+    const unsigned char* p = base;
+
+    unsigned int version = 0, count = 0;
+    unsigned long long tocOffset = 0;
+    bool ok = std::memcmp(p, PACK_MAGIC, 4) == 0;
+    p += 4;
+    ok = ok && readPod(p, end, version) && version == ASSET_PACK_VERSION &&
+        readPod(p, end, count) && readPod(p, end, tocOffset) &&
+        tocOffset <= pack->file.size;
+
+    p = base + (ok ? tocOffset : 0);
+    for (unsigned int i = 0; ok && i < count; ++i) {
+        unsigned int len = 0;
+        PackEntry e;
+        ok = readPod(p, end, len) && len <= 4096 &&
+            static_cast<size_t>(end - p) >= len;
+        if (!ok) break;
+
+        std::string key(reinterpret_cast<const char*>(p), len);
+        p += len;
+        ok = readPod(p, end, e.offset) && readPod(p, end, e.size) &&
+            e.offset <= tocOffset && e.size <= tocOffset - e.offset;
+        if (ok) pack->toc[key] = e;
+    }
+
+    if (!ok) {
+        std::cerr << "Asset pack " << packPath << " is invalid, ignoring it\n";
+        delete pack;
+        return false;
+    }
+
+    closeAssetPack();
+    gPack = pack;
+    return true;
+}
+
+void closeAssetPack() {
+    delete gPack;
+    gPack = nullptr;
+}
+
+bool assetPackOpen() {
+    return gPack != nullptr;
+}
+
+bool findPackedAsset(const std::string& path,
+    const unsigned char*& data, size_t& size) {
+    if (!gPack) return false;
+
+    auto it = gPack->toc.find(packKey(path));
+    if (it == gPack->toc.end()) return false;
+
+    data = reinterpret_cast<const unsigned char*>(gPack->file.data) + it->second.offset;
+    size = static_cast<size_t>(it->second.size);
+    gPackHits++;
+    return true;
+}
+
+AssetPackStats assetPackStats() {
+    AssetPackStats s;
+    if (gPack) {
+        s.entries = static_cast<int>(gPack->toc.size());
+        s.bytes = gPack->file.size;
+    }
+    s.hits = gPackHits;
+    return s;
+}
@@ -0,0 +1,46 @@
+// assetpack.hpp
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One archive ("assets.pak") holding every cooked file the game reads:
+// meshes, models (with their materials) and texture mip chains.
+//
+// Layout (little endian):
+//   "DPAK", u32 version, u32 entryCount, u64 tocOffset
+//   entry data, each entry 16-byte aligned
+//   table of contents: per entry u32 pathLength, path, u64 offset, u64 size
+//
+// Entries are keyed by the normalized, lower-cased path of the file they
+// were packed from ("assets/zombie/source/obj/obj/zombie001.obj.cooked").
+// At runtime the pack is memory-mapped once and the cooked readers
+// (meshcache.cpp) look there before touching the file system.
+
+const unsigned int ASSET_PACK_VERSION = 1;
+
+// '\\' -> '/', "." / ".." folded, lower case on Windows
+std::string normalizeAssetPath(const std::string& path);
+
+// Packs `files` (usually cookedFilesUsed() after a full load).
+bool writeAssetPack(const std::string& packPath,
+    const std::vector<std::string>& files);
+
+// Maps the pack; false (and nothing changes) if it is missing or invalid.
+// The mapping lives until closeAssetPack; it is not torn down at exit, so
+// texture workers still running then can't read from an unmapped pack.
+bool openAssetPack(const std::string& packPath);
+void closeAssetPack();
+bool assetPackOpen();
+
+// Safe to call from any thread while the pack is open.
+bool findPackedAsset(const std::string& path,
+    const unsigned char*& data, size_t& size);
+
+struct AssetPackStats {
+    int entries = 0;
+    size_t bytes = 0;     // size of the mapped file
+    int hits = 0;         // findPackedAsset lookups that found an entry
+};
+
+AssetPackStats assetPackStats();
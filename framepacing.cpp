@@ -0,0 +1,192 @@
+// framepacing.cpp
+#include "framepacing.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <mmsystem.h>   // timeBeginPeriod
+#ifdef _MSC_VER
+#pragma comment(lib, "winmm.lib")
+#endif
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <glut.h>
+#include "glcalls.hpp"
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+PresentMode gPresentMode = PRESENT_VSYNC;
+double gTargetFps = 60.0;
+
+static FrameLimiter gLimiter;
+
+const char* presentModeName(PresentMode mode) {
+    switch (mode) {
+    case PRESENT_VSYNC:      return "vsync";
+    case PRESENT_UNCAPPED:   return "uncapped";
+    case PRESENT_TARGET_FPS: return "fps";
+    }
+    return "?";
+}
+
+bool parsePresentMode(const char* name, PresentMode& out) {
+    for (int m = PRESENT_VSYNC; m <= PRESENT_TARGET_FPS; ++m) {
+        if (strcmp(name, presentModeName(static_cast<PresentMode>(m))) == 0) {
+            out = static_cast<PresentMode>(m);
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------- Swap interval ----------
+
+#ifdef _WIN32
+typedef BOOL(WINAPI* SwapIntervalFn)(int interval);
+
+static bool setSwapInterval(int interval) {
+    SwapIntervalFn swapInterval = reinterpret_cast<SwapIntervalFn>(
+        wglGetProcAddress("wglSwapIntervalEXT"));
+    return swapInterval && swapInterval(interval);
+}
+#else
+typedef void (*SwapIntervalEXTFn)(Display* display, GLXDrawable drawable, int interval);
+typedef int (*SwapIntervalMESAFn)(unsigned int interval);
+
+// glXGetProcAddress returns a stub for any name, so ask the extension string
+static bool hasGLXExtension(Display* display, const char* name) {
+    const char* extensions = glXQueryExtensionsString(display, DefaultScreen(display));
+    if (!extensions) return false;
+    size_t len = strlen(name);
+    for (const char* p = strstr(extensions, name); p; p = strstr(p + len, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+static bool setSwapInterval(int interval) {
+    Display* display = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (!display || !drawable) return false;
+
+    if (hasGLXExtension(display, "GLX_EXT_swap_control")) {
+        SwapIntervalEXTFn swapInterval = reinterpret_cast<SwapIntervalEXTFn>(
+            glXGetProcAddressARB(reinterpret_cast<const GLubyte*>("glXSwapIntervalEXT")));
+        if (swapInterval) {
+            swapInterval(display, drawable, interval);
+            return true;
+        }
+    }
+    if (hasGLXExtension(display, "GLX_MESA_swap_control")) {
+        SwapIntervalMESAFn swapInterval = reinterpret_cast<SwapIntervalMESAFn>(
+            glXGetProcAddressARB(reinterpret_cast<const GLubyte*>("glXSwapIntervalMESA")));
+        return swapInterval && swapInterval(interval) == 0;
+    }
+    return false;
+}
+#endif
+
+bool applyPresentMode() {
+    gLimiter.next = Clock::time_point();
+    if (!gGLUTWindow) return false;
+    return setSwapInterval(gPresentMode == PRESENT_VSYNC ? 1 : 0);
+}
+
+// ---------- Frame limiter ----------
+
+void FrameLimiter::waitUntil(Clock::time_point deadline) {
+    using Ms = std::chrono::duration<double, std::milli>;
+
+    // sleep while even a slow sleep ends before the deadline
+    while (Ms(deadline - Clock::now()).count() > sleepEstimateMs) {
+        Clock::time_point start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        double slept = Ms(Clock::now() - start).count();
+
+        ++sleeps;
+        double delta = slept - sleepMeanMs;
+        sleepMeanMs += delta / sleeps;
+        sleepM2 += delta * (slept - sleepMeanMs);
+        double stddev = sleeps > 1 ? std::sqrt(sleepM2 / (sleeps - 1)) : 0.0;
+        sleepEstimateMs = sleepMeanMs + stddev;
+    }
+
+    while (Clock::now() < deadline) {
+    }
+}
+
+void FrameLimiter::wait(double fps) {
+    if (fps <= 0.0) return;
+#ifdef _WIN32
+    // 1 ms scheduler ticks instead of ~15.6, so sleeps are worth taking
+    static bool fineTimer = timeBeginPeriod(1) == TIMERR_NOERROR;
+    (void)fineTimer;
+#endif
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / fps));
+
+    // late: this frame goes now and the schedule starts again from it
+    Clock::time_point now = Clock::now();
+    if (next == Clock::time_point() || now >= next)
+        next = now;
+    else
+        waitUntil(next);
+    next += period;
+}
+
+// ---------- Present timing ----------
+
+static const int PRESENT_HISTORY = 120;
+static double gPresentIntervals[PRESENT_HISTORY];
+static int gPresentCount = 0;   // intervals recorded, ever
+static Clock::time_point gLastPresent;
+
+static void notePresent() {
+    Clock::time_point now = Clock::now();
+    if (gLastPresent != Clock::time_point()) {
+        gPresentIntervals[gPresentCount % PRESENT_HISTORY] =
+            std::chrono::duration<double, std::milli>(now - gLastPresent).count();
+        ++gPresentCount;
+    }
+    gLastPresent = now;
+}
+
+PresentStats presentStats() {
+    PresentStats s;
+    s.frames = std::min(gPresentCount, PRESENT_HISTORY);
+    if (s.frames == 0) return s;
+
+    double sum = 0.0;
+    for (int i = 0; i < s.frames; ++i) {
+        sum += gPresentIntervals[i];
+        s.maxMs = std::max(s.maxMs, gPresentIntervals[i]);
+    }
+    s.meanMs = sum / s.frames;
+
+    double var = 0.0;
+    for (int i = 0; i < s.frames; ++i) {
+        double d = gPresentIntervals[i] - s.meanMs;
+        var += d * d;
+    }
+    s.jitterMs = std::sqrt(var / s.frames);
+    return s;
+}
+
+void presentFrame() {
+    if (gPresentMode == PRESENT_TARGET_FPS) gLimiter.wait(gTargetFps);
+
+    if (gGLUTWindow) glutSwapBuffers();
+    else glFlush();
+    notePresent();
+}
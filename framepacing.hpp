@@ -0,0 +1,63 @@
+// framepacing.hpp
+#pragma once
+#include <chrono>
+
+// ---------- Presentation ----------
+//
+// The window is double buffered. Display() draws into the back buffer and
+// ends with presentFrame(), which (in PRESENT_TARGET_FPS) waits for the
+// frame's slot, swaps, and notes when the swap returned. Offscreen
+// (--bench-gl) there is nothing to swap and the frame is only flushed.
+
+enum PresentMode {
+    PRESENT_VSYNC,        // swap interval 1: the display's refresh paces frames
+    PRESENT_UNCAPPED,     // swap interval 0, as fast as frames are drawn (tears)
+    PRESENT_TARGET_FPS    // swap interval 0, FrameLimiter spaces frames 1 / gTargetFps apart
+};
+
+extern PresentMode gPresentMode;
+extern double gTargetFps;
+
+const char* presentModeName(PresentMode mode);
+bool parsePresentMode(const char* name, PresentMode& out);   // "vsync", "uncapped", "fps"
+
+// Sets the current window's swap interval for gPresentMode (WGL / GLX
+// swap control). False if the driver has none, in which case vsync is
+// whatever the driver defaults to.
+bool applyPresentMode();
+
+void presentFrame();
+
+// ---------- Frame limiter ----------
+//
+// Waits for deadlines spaced one period apart. It sleeps while the
+// deadline is further off than a sleep is likely to take, then spins for
+// the rest. How long a 1 ms sleep really takes (mean + one standard
+// deviation of the ones so far) is learned as it goes, so coarse OS timers
+// cost more spinning rather than late frames. A frame that misses its
+// deadline restarts the schedule from now instead of rushing the next ones
+// out to catch up.
+
+struct FrameLimiter {
+    std::chrono::steady_clock::time_point next;   // the coming deadline; zero before the first frame
+
+    double sleepEstimateMs = 2.0;   // what a sleep_for(1 ms) is taken to cost
+    double sleepMeanMs = 1.0;
+    double sleepM2 = 0.0;           // Welford sum of squared deviations
+    long long sleeps = 0;
+
+    void wait(double fps);
+    void waitUntil(std::chrono::steady_clock::time_point deadline);
+};
+
+// ---------- Present timing ----------
+
+// Present-to-present intervals over the last PRESENT_HISTORY frames
+struct PresentStats {
+    int frames = 0;
+    double meanMs = 0.0;
+    double jitterMs = 0.0;   // standard deviation of the interval
+    double maxMs = 0.0;
+};
+
+PresentStats presentStats();
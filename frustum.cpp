@@ -0,0 +1,193 @@
+// frustum.cpp
+#include "frustum.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULL_SSE 1
+#include <emmintrin.h>
+#else
+#define CULL_SSE 0
+#endif
+
+// ---------- Planes ----------
+
+Frustum frustumFromMatrix(const float m[16]) {
+    // Gribb / Hartmann: each plane is row 3 of the clip matrix plus or
+    // minus row 0 (left / right), 1 (bottom / top) or 2 (near / far)
+    Frustum f;
+    for (int p = 0; p < 6; ++p) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        for (int c = 0; c < 4; ++c)
+            f.planes[p][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+    }
+    return f;
+}
+
+// ---------- Camera matrices ----------
+
+void multiplyMatrices(const float a[16], const float b[16], float out[16]) {
+    float m[16];
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            m[c * 4 + r] =
+                a[0 * 4 + r] * b[c * 4 + 0] +
+                a[1 * 4 + r] * b[c * 4 + 1] +
+                a[2 * 4 + r] * b[c * 4 + 2] +
+                a[3 * 4 + r] * b[c * 4 + 3];
+        }
+    }
+    for (int i = 0; i < 16; ++i) out[i] = m[i];
+}
+
+void perspectiveMatrix(float fovyDegrees, float aspect, float zNear, float zFar,
+    float out[16]) {
+    float f = 1.0f / std::tan(fovyDegrees * 3.14159265f / 360.0f);
+    for (int i = 0; i < 16; ++i) out[i] = 0.0f;
+    out[0] = f / aspect;
+    out[5] = f;
+    out[10] = (zFar + zNear) / (zNear - zFar);
+    out[11] = -1.0f;
+    out[14] = 2.0f * zFar * zNear / (zNear - zFar);
+}
+
+void lookAtMatrix(const float eye[3], const float center[3], const float up[3],
+    float out[16]) {
+    float f[3] = { center[0] - eye[0], center[1] - eye[1], center[2] - eye[2] };
+    float fl = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (int i = 0; i < 3; ++i) f[i] /= fl;
+
+    // s = f x up, u = s x f, as gluLookAt (s normalized, u then is too)
+    float s[3] = {
+        f[1] * up[2] - f[2] * up[1],
+        f[2] * up[0] - f[0] * up[2],
+        f[0] * up[1] - f[1] * up[0]
+    };
+    float sl = std::sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    for (int i = 0; i < 3; ++i) s[i] /= sl;
+    float u[3] = {
+        s[1] * f[2] - s[2] * f[1],
+        s[2] * f[0] - s[0] * f[2],
+        s[0] * f[1] - s[1] * f[0]
+    };
+
+    // rows s, u, -f, then translate by -eye
+    for (int c = 0; c < 3; ++c) {
+        out[c * 4 + 0] = s[c];
+        out[c * 4 + 1] = u[c];
+        out[c * 4 + 2] = -f[c];
+        out[c * 4 + 3] = 0.0f;
+    }
+    out[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    out[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    out[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    out[15] = 1.0f;
+}
+
+// ---------- Boxes ----------
+
+WorldBox transformBox(const float localMin[3], const float localMax[3],
+    float x, float y, float z, float ry, float sx, float sy, float sz) {
+    float lc[3], le[3];
+    const float s[3] = { sx, sy, sz };
+    for (int i = 0; i < 3; ++i) {
+        lc[i] = (localMin[i] + localMax[i]) * 0.5f * s[i];
+        le[i] = (localMax[i] - localMin[i]) * 0.5f * std::fabs(s[i]);
+    }
+
+    // glRotatef(ry, 0, 1, 0): x' = c*x + s*z, z' = -s*x + c*z; the
+    // extents of the rotated box are the absolute values of the same matrix
+    float a = ry * 3.14159265f / 180.0f;
+    float ca = std::cos(a), sa = std::sin(a);
+
+    WorldBox b;
+    b.cx = x + ca * lc[0] + sa * lc[2];
+    b.cy = y + lc[1];
+    b.cz = z - sa * lc[0] + ca * lc[2];
+    b.ex = std::fabs(ca) * le[0] + std::fabs(sa) * le[2];
+    b.ey = le[1];
+    b.ez = std::fabs(sa) * le[0] + std::fabs(ca) * le[2];
+    return b;
+}
+
+void CullList::clear() {
+    cx.clear(); cy.clear(); cz.clear();
+    ex.clear(); ey.clear(); ez.clear();
+}
+
+void CullList::add(const WorldBox& box) {
+    cx.push_back(box.cx); cy.push_back(box.cy); cz.push_back(box.cz);
+    ex.push_back(box.ex); ey.push_back(box.ey); ez.push_back(box.ez);
+}
+
+// ---------- Test ----------
+
+// box outside a plane: distance of the centre + projected radius < 0
+static bool boxVisible(const Frustum& f, float cx, float cy, float cz,
+    float ex, float ey, float ez) {
+    for (int p = 0; p < 6; ++p) {
+        const float* pl = f.planes[p];
+        float d = pl[0] * cx + pl[1] * cy + pl[2] * cz + pl[3];
+        float r = std::fabs(pl[0]) * ex + std::fabs(pl[1]) * ey + std::fabs(pl[2]) * ez;
+        if (d + r < 0.0f) return false;
+    }
+    return true;
+}
+
+int cullBoxes(const Frustum& f, const CullList& boxes,
+    std::vector<unsigned char>& visible) {
+    const int n = boxes.size();
+    visible.resize(n);
+    int count = 0;
+    int i = 0;
+
+#if CULL_SSE
+    __m128 pa[6], pb[6], pc[6], pd[6], aa[6], ab[6], ac[6];
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    for (int p = 0; p < 6; ++p) {
+        pa[p] = _mm_set1_ps(f.planes[p][0]);
+        pb[p] = _mm_set1_ps(f.planes[p][1]);
+        pc[p] = _mm_set1_ps(f.planes[p][2]);
+        pd[p] = _mm_set1_ps(f.planes[p][3]);
+        aa[p] = _mm_and_ps(pa[p], absMask);
+        ab[p] = _mm_and_ps(pb[p], absMask);
+        ac[p] = _mm_and_ps(pc[p], absMask);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.cx[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.cy[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.cz[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.ex[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.ey[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.ez[i]);
+
+        // lanes stay set while every plane so far has the box on its inside
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; ++p) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(pa[p], cx), _mm_mul_ps(pb[p], cy)),
+                _mm_add_ps(_mm_mul_ps(pc[p], cz), pd[p]));
+            __m128 r = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(aa[p], ex), _mm_mul_ps(ab[p], ey)),
+                _mm_mul_ps(ac[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpnlt_ps(_mm_add_ps(d, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k) {
+            visible[i + k] = (mask >> k) & 1;
+            count += visible[i + k];
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        visible[i] = boxVisible(f, boxes.cx[i], boxes.cy[i], boxes.cz[i],
+            boxes.ex[i], boxes.ey[i], boxes.ez[i]) ? 1 : 0;
+        count += visible[i];
+    }
+    return count;
+}
@@ -0,0 +1,59 @@
+// frustum.hpp
+#pragma once
+#include <vector>
+
+// ---------- View-frustum culling ----------
+//
+// Objects are bounded by world-space AABBs (centre + half extents) derived
+// from their mesh bounds and placement, and tested against the six planes
+// of projection * modelview. The boxes are kept in structure-of-arrays
+// form so the test runs four boxes per SSE register, plane by plane;
+// scalar elsewhere. A box is culled only if it is entirely outside one
+// plane, so a few boxes near the frustum corners are kept that could go.
+
+struct Frustum {
+    // a, b, c, d: inside where a*x + b*y + c*z + d >= 0 (not normalized)
+    float planes[6][4];
+};
+
+// ---------- Camera matrices ----------
+//
+// Column-major like glLoadMatrixf, so the camera can be built without a GL
+// context (the software renderer) and still match what GL would compute.
+
+// out = a * b
+void multiplyMatrices(const float a[16], const float b[16], float out[16]);
+
+// gluPerspective
+void perspectiveMatrix(float fovyDegrees, float aspect, float zNear, float zFar,
+    float out[16]);
+
+// gluLookAt
+void lookAtMatrix(const float eye[3], const float center[3], const float up[3],
+    float out[16]);
+
+// planes of clip = projection * modelview (column-major, as glGetFloatv)
+Frustum frustumFromMatrix(const float clip[16]);
+
+struct WorldBox {
+    float cx, cy, cz;   // centre
+    float ex, ey, ez;   // half extents
+};
+
+// local AABB under translate(x, y, z) * rotateY(ry degrees) * scale(sx, sy, sz),
+// the GameObject transform
+WorldBox transformBox(const float localMin[3], const float localMax[3],
+    float x, float y, float z, float ry, float sx, float sy, float sz);
+
+struct CullList {
+    std::vector<float> cx, cy, cz, ex, ey, ez;
+
+    int size() const { return static_cast<int>(cx.size()); }
+    void clear();
+    void add(const WorldBox& box);
+    WorldBox box(int i) const { return { cx[i], cy[i], cz[i], ex[i], ey[i], ez[i] }; }
+};
+
+// visible[i] = 1 if box i may be inside the frustum; returns how many are
+int cullBoxes(const Frustum& frustum, const CullList& boxes,
+    std::vector<unsigned char>& visible);
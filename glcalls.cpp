@@ -0,0 +1,1444 @@
+// glcalls.cpp
+#define GLCALLS_NO_REDIRECT   // the wrappers below call the real entry points
+#include "glcalls.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+
+#ifdef _WIN32
+#define GLC_CALL __stdcall
+#else
+#define GLC_CALL
+#endif
+
+bool gGLUTWindow = true;
+
+// ---------- Counting ----------
+
+static GLCallStats gCurrentCalls;
+static GLCallStats gLastCalls;
+
+static inline void count(GLCallCategory category) {
+    gCurrentCalls.calls[category]++;
+}
+
+const char* glCallCategoryName(int category) {
+    static const char* NAMES[GLCALL_CATEGORIES] = {
+        "state", "matrix", "vertex", "texture", "buffer", "shader", "list", "draw", "query"
+    };
+    return (category >= 0 && category < GLCALL_CATEGORIES) ? NAMES[category] : "?";
+}
+
+int GLCallStats::total() const {
+    int n = 0;
+    for (int c : calls) n += c;
+    return n;
+}
+
+GLCallStats glCallStats() {
+    return gLastCalls;
+}
+
+// ---------- Log records ----------
+
+static const char GLLOG_MAGIC[4] = { 'G', 'L', 'R', 'C' };
+static const int GLLOG_VERSION = 1;
+
+enum GLOp : unsigned char {
+    OP_FRAME = 1,
+
+    OP_ENABLE, OP_DISABLE, OP_ENABLE_CLIENT, OP_DISABLE_CLIENT, OP_COLOR3F,
+    OP_LINE_WIDTH, OP_CLEAR_COLOR, OP_CLEAR, OP_FLUSH, OP_PIXEL_STORE, OP_LIGHTFV,
+
+    OP_MATRIX_MODE, OP_LOAD_IDENTITY, OP_LOAD_MATRIX, OP_PUSH_MATRIX, OP_POP_MATRIX,
+    OP_TRANSLATE, OP_ROTATE, OP_SCALE, OP_ORTHO2D, OP_LOOK_AT,
+
+    OP_BEGIN, OP_END, OP_VERTEX3F, OP_NORMAL3F, OP_TEXCOORD2F, OP_RASTER_POS2F,
+    OP_BITMAP_CHAR, OP_SOLID_CUBE,
+
+    OP_GEN_TEXTURES, OP_BIND_TEXTURE, OP_TEX_PARAMETERI, OP_TEX_IMAGE2D, OP_DELETE_TEXTURES,
+
+    OP_GEN_LISTS, OP_NEW_LIST, OP_END_LIST, OP_CALL_LIST, OP_DELETE_LISTS,
+
+    OP_ARRAY_POINTER,     // kind, size, type, stride, offset into the bound buffer
+    OP_CLIENT_ARRAY,      // kind, size, type, stride, the bytes a draw reads
+    OP_DRAW_ELEMENTS,     // mode, count, type, inline?, indices or offset
+
+    OP_GEN_BUFFERS, OP_DELETE_BUFFERS, OP_BIND_BUFFER, OP_BUFFER_DATA, OP_BUFFER_SUB_DATA,
+
+    OP_CREATE_SHADER, OP_SHADER_SOURCE, OP_COMPILE_SHADER, OP_DELETE_SHADER,
+    OP_CREATE_PROGRAM, OP_ATTACH_SHADER, OP_BIND_ATTRIB_LOCATION, OP_LINK_PROGRAM,
+    OP_USE_PROGRAM, OP_UNIFORM_LOCATION, OP_UNIFORM1I,
+
+    OP_VERTEX_ATTRIB_POINTER, OP_ENABLE_ATTRIB, OP_DISABLE_ATTRIB, OP_ATTRIB_DIVISOR,
+    OP_DRAW_INSTANCED
+};
+
+// client arrays, as OP_ARRAY_POINTER / OP_CLIENT_ARRAY kinds
+enum { ARRAY_VERTEX, ARRAY_NORMAL, ARRAY_TEXCOORD, ARRAY_KINDS };
+
+static FILE* gLogFile = nullptr;
+static std::vector<unsigned char> gLogBuffer;
+static std::string gLogPath;
+static int gLogFramesLeft = 0;
+static size_t gLogBytes = 0;
+
+bool glRecording() {
+    return gLogFile != nullptr;
+}
+
+static void flushLog() {
+    if (!gLogFile || gLogBuffer.empty()) return;
+    fwrite(gLogBuffer.data(), 1, gLogBuffer.size(), gLogFile);
+    gLogBytes += gLogBuffer.size();
+    gLogBuffer.clear();
+}
+
+template <typename T>
+static void put(const T& value) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&value);
+    gLogBuffer.insert(gLogBuffer.end(), p, p + sizeof(T));
+}
+
+static void putBytes(const void* data, size_t size) {
+    put(static_cast<unsigned int>(size));
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    if (size) gLogBuffer.insert(gLogBuffer.end(), p, p + size);
+    if (gLogBuffer.size() > (1u << 20)) flushLog();
+}
+
+static void op(GLOp code) {
+    gLogBuffer.push_back(code);
+}
+
+static void closeLog() {
+    if (!gLogFile) return;
+    flushLog();
+    bool ok = !ferror(gLogFile);
+    fclose(gLogFile);
+    gLogFile = nullptr;
+    printf("GL recording %s %s (%.1f MB)\n", gLogPath.c_str(),
+        ok ? "written" : "failed", gLogBytes / (1024.0 * 1024.0));
+}
+
+bool startGLRecording(const std::string& path, int frames, int width, int height) {
+    static bool closeAtExit = false;
+    if (gLogFile) return false;
+    gLogFile = fopen(path.c_str(), "wb");
+    if (!gLogFile) return false;
+
+    gLogPath = path;
+    gLogFramesLeft = frames > 0 ? frames : 1;
+    gLogBytes = 0;
+    gLogBuffer.clear();
+    for (char c : GLLOG_MAGIC) gLogBuffer.push_back(static_cast<unsigned char>(c));
+    put(GLLOG_VERSION);
+    put(width);
+    put(height);
+
+    // the frames so far if the program ends before all were recorded
+    if (!closeAtExit) closeAtExit = atexit(closeLog) == 0;
+    return true;
+}
+
+void glCallsEndFrame() {
+    gLastCalls = gCurrentCalls;
+    gCurrentCalls = GLCallStats();
+
+    if (!gLogFile) return;
+    op(OP_FRAME);
+    if (--gLogFramesLeft == 0) closeLog();
+}
+
+// ---------- Client arrays ----------
+//
+// A pointer set with no buffer bound is client memory that GL only reads
+// at the draw, so it is kept here and the range the draw's indices reach
+// is copied into the log just before it.
+
+struct ClientArray {
+    bool enabled = false;
+    bool client = false;        // pointer is client memory, not a buffer offset
+    GLint size = 0;
+    GLenum type = GL_FLOAT;
+    GLsizei stride = 0;
+    const GLvoid* pointer = nullptr;
+};
+
+static ClientArray gArrays[ARRAY_KINDS];
+static GLuint gArrayBuffer = 0;
+static GLuint gElementBuffer = 0;
+static GLint gUnpackAlignment = 4;
+
+static int arrayKind(GLenum array) {
+    switch (array) {
+    case GL_VERTEX_ARRAY:        return ARRAY_VERTEX;
+    case GL_NORMAL_ARRAY:        return ARRAY_NORMAL;
+    case GL_TEXTURE_COORD_ARRAY: return ARRAY_TEXCOORD;
+    default:                     return -1;
+    }
+}
+
+static size_t typeSize(GLenum type) {
+    switch (type) {
+    case GL_UNSIGNED_BYTE:  return 1;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:          return 2;
+    case GL_DOUBLE:         return 8;
+    default:                return 4;   // GL_FLOAT, GL_INT, GL_UNSIGNED_INT
+    }
+}
+
+static void setArrayPointer(int kind, GLint size, GLenum type, GLsizei stride,
+    const GLvoid* pointer) {
+    ClientArray& a = gArrays[kind];
+    a.size = size;
+    a.type = type;
+    a.stride = stride;
+    a.pointer = pointer;
+    a.client = gArrayBuffer == 0;
+
+    if (!gLogFile || a.client) return;
+    op(OP_ARRAY_POINTER);
+    put(static_cast<unsigned char>(kind));
+    put(size);
+    put(type);
+    put(stride);
+    put(static_cast<unsigned long long>(reinterpret_cast<size_t>(pointer)));
+}
+
+// the enabled client arrays up to vertex maxIndex, before a draw
+static void recordClientArrays(unsigned int maxIndex) {
+    for (int kind = 0; kind < ARRAY_KINDS; ++kind) {
+        const ClientArray& a = gArrays[kind];
+        if (!a.enabled || !a.client || !a.pointer) continue;
+
+        size_t element = a.size * typeSize(a.type);
+        size_t stride = a.stride ? a.stride : element;
+        op(OP_CLIENT_ARRAY);
+        put(static_cast<unsigned char>(kind));
+        put(a.size);
+        put(a.type);
+        put(static_cast<GLsizei>(stride));
+        putBytes(a.pointer, maxIndex * stride + element);
+    }
+}
+
+static unsigned int maxIndexOf(GLsizei count, GLenum type, const GLvoid* indices) {
+    unsigned int m = 0;
+    for (GLsizei i = 0; i < count; ++i) {
+        unsigned int v;
+        if (type == GL_UNSIGNED_SHORT) v = static_cast<const GLushort*>(indices)[i];
+        else if (type == GL_UNSIGNED_BYTE) v = static_cast<const GLubyte*>(indices)[i];
+        else v = static_cast<const GLuint*>(indices)[i];
+        if (v > m) m = v;
+    }
+    return m;
+}
+
+static size_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    size_t channels = 4;
+    switch (format) {
+    case GL_RGB:             channels = 3; break;
+    case GL_LUMINANCE_ALPHA: channels = 2; break;
+    case GL_LUMINANCE:
+    case GL_ALPHA:
+    case GL_RED:             channels = 1; break;
+    default:                 break;
+    }
+    size_t align = gUnpackAlignment > 0 ? gUnpackAlignment : 1;
+    size_t row = (width * channels * typeSize(type) + align - 1) / align * align;
+    return row * height;
+}
+
+// ---------- Core wrappers ----------
+
+void glcEnable(GLenum cap) {
+    count(GLCALL_STATE);
+    if (gLogFile) { op(OP_ENABLE); put(cap); }
+    glEnable(cap);
+}
+
+void glcDisable(GLenum cap) {
+    count(GLCALL_STATE);
+    if (gLogFile) { op(OP_DISABLE); put(cap); }
+    glDisable(cap);
+}
+
+void glcEnableClientState(GLenum array) {
+    count(GLCALL_STATE);
+    int kind = arrayKind(array);
+    if (kind >= 0) gArrays[kind].enabled = true;
+    if (gLogFile) { op(OP_ENABLE_CLIENT); put(array); }
+    glEnableClientState(array);
+}
+
+void glcDisableClientState(GLenum array) {
+    count(GLCALL_STATE);
+    int kind = arrayKind(array);
+    if (kind >= 0) gArrays[kind].enabled = false;
+    if (gLogFile) { op(OP_DISABLE_CLIENT); put(array); }
+    glDisableClientState(array);
+}
+
+void glcColor3f(GLfloat r, GLfloat g, GLfloat b) {
+    count(GLCALL_STATE);
+    if (gLogFile) { op(OP_COLOR3F); put(r); put(g); put(b); }
+    glColor3f(r, g, b);
+}
+
+void glcLineWidth(GLfloat width) {
+    count(GLCALL_STATE);
+    if (gLogFile) { op(OP_LINE_WIDTH); put(width); }
+    glLineWidth(width);
+}
+
+void glcClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a) {
+    count(GLCALL_STATE);
+    if (gLogFile) { op(OP_CLEAR_COLOR); put(r); put(g); put(b); put(a); }
+    glClearColor(r, g, b, a);
+}
+
+void glcClear(GLbitfield mask) {
+    count(GLCALL_DRAW);
+    if (gLogFile) { op(OP_CLEAR); put(mask); }
+    glClear(mask);
+}
+
+void glcFlush() {
+    count(GLCALL_STATE);
+    if (gLogFile) op(OP_FLUSH);
+    glFlush();
+}
+
+void glcPixelStorei(GLenum pname, GLint param) {
+    count(GLCALL_STATE);
+    if (pname == GL_UNPACK_ALIGNMENT) gUnpackAlignment = param;
+    if (gLogFile) { op(OP_PIXEL_STORE); put(pname); put(param); }
+    glPixelStorei(pname, param);
+}
+
+static int lightValues(GLenum pname) {
+    switch (pname) {
+    case GL_AMBIENT: case GL_DIFFUSE: case GL_SPECULAR: case GL_POSITION: return 4;
+    case GL_SPOT_DIRECTION: return 3;
+    default: return 1;
+    }
+}
+
+void glcLightfv(GLenum light, GLenum pname, const GLfloat* params) {
+    count(GLCALL_STATE);
+    if (gLogFile) {
+        op(OP_LIGHTFV); put(light); put(pname);
+        putBytes(params, lightValues(pname) * sizeof(GLfloat));
+    }
+    glLightfv(light, pname, params);
+}
+
+void glcMatrixMode(GLenum mode) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) { op(OP_MATRIX_MODE); put(mode); }
+    glMatrixMode(mode);
+}
+
+void glcLoadIdentity() {
+    count(GLCALL_MATRIX);
+    if (gLogFile) op(OP_LOAD_IDENTITY);
+    glLoadIdentity();
+}
+
+void glcLoadMatrixf(const GLfloat* m) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) {
+        op(OP_LOAD_MATRIX);
+        for (int i = 0; i < 16; ++i) put(m[i]);
+    }
+    glLoadMatrixf(m);
+}
+
+void glcPushMatrix() {
+    count(GLCALL_MATRIX);
+    if (gLogFile) op(OP_PUSH_MATRIX);
+    glPushMatrix();
+}
+
+void glcPopMatrix() {
+    count(GLCALL_MATRIX);
+    if (gLogFile) op(OP_POP_MATRIX);
+    glPopMatrix();
+}
+
+void glcTranslatef(GLfloat x, GLfloat y, GLfloat z) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) { op(OP_TRANSLATE); put(x); put(y); put(z); }
+    glTranslatef(x, y, z);
+}
+
+void glcRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) { op(OP_ROTATE); put(angle); put(x); put(y); put(z); }
+    glRotatef(angle, x, y, z);
+}
+
+void glcScalef(GLfloat x, GLfloat y, GLfloat z) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) { op(OP_SCALE); put(x); put(y); put(z); }
+    glScalef(x, y, z);
+}
+
+void glcOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) { op(OP_ORTHO2D); put(left); put(right); put(bottom); put(top); }
+    gluOrtho2D(left, right, bottom, top);
+}
+
+void glcLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ,
+    GLdouble centerX, GLdouble centerY, GLdouble centerZ,
+    GLdouble upX, GLdouble upY, GLdouble upZ) {
+    count(GLCALL_MATRIX);
+    if (gLogFile) {
+        op(OP_LOOK_AT);
+        put(eyeX); put(eyeY); put(eyeZ);
+        put(centerX); put(centerY); put(centerZ);
+        put(upX); put(upY); put(upZ);
+    }
+    gluLookAt(eyeX, eyeY, eyeZ, centerX, centerY, centerZ, upX, upY, upZ);
+}
+
+void glcBegin(GLenum mode) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_BEGIN); put(mode); }
+    glBegin(mode);
+}
+
+void glcEnd() {
+    count(GLCALL_VERTEX);
+    if (gLogFile) op(OP_END);
+    glEnd();
+}
+
+void glcVertex3f(GLfloat x, GLfloat y, GLfloat z) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_VERTEX3F); put(x); put(y); put(z); }
+    glVertex3f(x, y, z);
+}
+
+void glcVertex3fv(const GLfloat* v) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_VERTEX3F); put(v[0]); put(v[1]); put(v[2]); }
+    glVertex3fv(v);
+}
+
+void glcNormal3fv(const GLfloat* v) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_NORMAL3F); put(v[0]); put(v[1]); put(v[2]); }
+    glNormal3fv(v);
+}
+
+void glcTexCoord2fv(const GLfloat* v) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_TEXCOORD2F); put(v[0]); put(v[1]); }
+    glTexCoord2fv(v);
+}
+
+void glcRasterPos2f(GLfloat x, GLfloat y) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_RASTER_POS2F); put(x); put(y); }
+    glRasterPos2f(x, y);
+}
+
+// glutSolidCube's faces, for when there is no GLUT window
+static void drawSolidCube(GLdouble size) {
+    static const GLfloat NORMALS[6][3] = {
+        { -1, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    };
+    static const int FACES[6][4] = {
+        { 0, 1, 2, 3 }, { 3, 2, 6, 7 }, { 7, 6, 5, 4 }, { 4, 5, 1, 0 }, { 5, 6, 2, 1 }, { 7, 4, 0, 3 }
+    };
+    GLfloat h = static_cast<GLfloat>(size / 2);
+    GLfloat v[8][3];
+    for (int i = 0; i < 8; ++i) {
+        v[i][0] = (i == 0 || i == 1 || i == 2 || i == 3) ? -h : h;
+        v[i][1] = (i == 0 || i == 1 || i == 4 || i == 5) ? -h : h;
+        v[i][2] = (i == 0 || i == 3 || i == 4 || i == 7) ? -h : h;
+    }
+
+    for (int f = 5; f >= 0; --f) {
+        glBegin(GL_QUADS);
+        glNormal3fv(NORMALS[f]);
+        for (int k = 0; k < 4; ++k) glVertex3fv(v[FACES[f][k]]);
+        glEnd();
+    }
+}
+
+// the bitmap font the game draws with; others are replayed with it too
+void glcBitmapCharacter(void* font, int character) {
+    count(GLCALL_VERTEX);
+    if (gLogFile) { op(OP_BITMAP_CHAR); put(character); }
+    if (gGLUTWindow) glutBitmapCharacter(font, character);
+    else glBitmap(0, 0, 0, 0, 8, 0, nullptr);
+}
+
+void glcSolidCube(GLdouble size) {
+    count(GLCALL_DRAW);
+    if (gLogFile) { op(OP_SOLID_CUBE); put(size); }
+    if (gGLUTWindow) glutSolidCube(size);
+    else drawSolidCube(size);
+}
+
+void glcGenTextures(GLsizei n, GLuint* textures) {
+    count(GLCALL_TEXTURE);
+    glGenTextures(n, textures);
+    if (gLogFile) { op(OP_GEN_TEXTURES); putBytes(textures, n * sizeof(GLuint)); }
+}
+
+void glcBindTexture(GLenum target, GLuint texture) {
+    count(GLCALL_TEXTURE);
+    if (gLogFile) { op(OP_BIND_TEXTURE); put(target); put(texture); }
+    glBindTexture(target, texture);
+}
+
+void glcTexParameteri(GLenum target, GLenum pname, GLint param) {
+    count(GLCALL_TEXTURE);
+    if (gLogFile) { op(OP_TEX_PARAMETERI); put(target); put(pname); put(param); }
+    glTexParameteri(target, pname, param);
+}
+
+void glcTexImage2D(GLenum target, GLint level, GLint internalFormat,
+    GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type,
+    const GLvoid* pixels) {
+    count(GLCALL_TEXTURE);
+    if (gLogFile) {
+        op(OP_TEX_IMAGE2D);
+        put(target); put(level); put(internalFormat); put(width); put(height);
+        put(border); put(format); put(type);
+        putBytes(pixels, pixels ? imageBytes(width, height, format, type) : 0);
+    }
+    glTexImage2D(target, level, internalFormat, width, height, border, format, type, pixels);
+}
+
+void glcDeleteTextures(GLsizei n, const GLuint* textures) {
+    count(GLCALL_TEXTURE);
+    if (gLogFile) { op(OP_DELETE_TEXTURES); putBytes(textures, n * sizeof(GLuint)); }
+    glDeleteTextures(n, textures);
+}
+
+GLuint glcGenLists(GLsizei range) {
+    count(GLCALL_LIST);
+    GLuint base = glGenLists(range);
+    if (gLogFile) { op(OP_GEN_LISTS); put(range); put(base); }
+    return base;
+}
+
+void glcNewList(GLuint list, GLenum mode) {
+    count(GLCALL_LIST);
+    if (gLogFile) { op(OP_NEW_LIST); put(list); put(mode); }
+    glNewList(list, mode);
+}
+
+void glcEndList() {
+    count(GLCALL_LIST);
+    if (gLogFile) op(OP_END_LIST);
+    glEndList();
+}
+
+void glcCallList(GLuint list) {
+    count(GLCALL_DRAW);
+    if (gLogFile) { op(OP_CALL_LIST); put(list); }
+    glCallList(list);
+}
+
+void glcDeleteLists(GLuint list, GLsizei range) {
+    count(GLCALL_LIST);
+    if (gLogFile) { op(OP_DELETE_LISTS); put(list); put(range); }
+    glDeleteLists(list, range);
+}
+
+void glcVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {
+    count(GLCALL_BUFFER);
+    setArrayPointer(ARRAY_VERTEX, size, type, stride, pointer);
+    glVertexPointer(size, type, stride, pointer);
+}
+
+void glcNormalPointer(GLenum type, GLsizei stride, const GLvoid* pointer) {
+    count(GLCALL_BUFFER);
+    setArrayPointer(ARRAY_NORMAL, 3, type, stride, pointer);
+    glNormalPointer(type, stride, pointer);
+}
+
+void glcTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer) {
+    count(GLCALL_BUFFER);
+    setArrayPointer(ARRAY_TEXCOORD, size, type, stride, pointer);
+    glTexCoordPointer(size, type, stride, pointer);
+}
+
+void glcDrawElements(GLenum mode, GLsizei count_, GLenum type, const GLvoid* indices) {
+    count(GLCALL_DRAW);
+    if (gLogFile) {
+        bool inlineIndices = gElementBuffer == 0;
+        if (inlineIndices)
+            recordClientArrays(count_ > 0 ? maxIndexOf(count_, type, indices) : 0);
+        else if (gArrays[ARRAY_VERTEX].enabled && gArrays[ARRAY_VERTEX].client) {
+            static bool warned = false;
+            if (!warned) {
+                printf("GL recording: client arrays drawn with an index buffer aren't recorded\n");
+                warned = true;
+            }
+        }
+
+        op(OP_DRAW_ELEMENTS);
+        put(mode); put(count_); put(type);
+        put(static_cast<unsigned char>(inlineIndices));
+        if (inlineIndices)
+            putBytes(indices, count_ * typeSize(type));
+        else
+            put(static_cast<unsigned long long>(reinterpret_cast<size_t>(indices)));
+    }
+    glDrawElements(mode, count_, type, indices);
+}
+
+void glcGetFloatv(GLenum pname, GLfloat* params) {
+    count(GLCALL_QUERY);
+    glGetFloatv(pname, params);
+}
+
+void glcGetIntegerv(GLenum pname, GLint* params) {
+    count(GLCALL_QUERY);
+    glGetIntegerv(pname, params);
+}
+
+GLboolean glcIsEnabled(GLenum cap) {
+    count(GLCALL_QUERY);
+    return glIsEnabled(cap);
+}
+
+const GLubyte* glcGetString(GLenum name) {
+    count(GLCALL_QUERY);
+    return glGetString(name);
+}
+
+// ---------- Runtime entry points ----------
+//
+// Same signatures as gpumesh.cpp's. realX is what the driver returned,
+// hookX what gpumesh.cpp gets instead.
+
+typedef void (GLC_CALL* GenBuffersFn)(GLsizei n, GLuint* buffers);
+typedef void (GLC_CALL* DeleteBuffersFn)(GLsizei n, const GLuint* buffers);
+typedef void (GLC_CALL* BindBufferFn)(GLenum target, GLuint buffer);
+typedef void (GLC_CALL* BufferDataFn)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (GLC_CALL* BufferSubDataFn)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+typedef GLuint(GLC_CALL* CreateShaderFn)(GLenum type);
+typedef void (GLC_CALL* ShaderSourceFn)(GLuint shader, GLsizei count, const char* const* src, const GLint* length);
+typedef void (GLC_CALL* ObjectFn)(GLuint object);
+typedef GLuint(GLC_CALL* CreateProgramFn)();
+typedef void (GLC_CALL* AttachShaderFn)(GLuint program, GLuint shader);
+typedef void (GLC_CALL* BindAttribLocationFn)(GLuint program, GLuint index, const char* name);
+typedef GLint(GLC_CALL* GetUniformLocationFn)(GLuint program, const char* name);
+typedef void (GLC_CALL* Uniform1iFn)(GLint location, GLint v0);
+typedef void (GLC_CALL* VertexAttribPointerFn)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef void (GLC_CALL* VertexAttribDivisorFn)(GLuint index, GLuint divisor);
+typedef void (GLC_CALL* DrawElementsInstancedFn)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+
+static GenBuffersFn            realGenBuffers = nullptr;
+static DeleteBuffersFn         realDeleteBuffers = nullptr;
+static BindBufferFn            realBindBuffer = nullptr;
+static BufferDataFn            realBufferData = nullptr;
+static BufferSubDataFn         realBufferSubData = nullptr;
+static CreateShaderFn          realCreateShader = nullptr;
+static ShaderSourceFn          realShaderSource = nullptr;
+static ObjectFn                realCompileShader = nullptr;
+static ObjectFn                realDeleteShader = nullptr;
+static CreateProgramFn         realCreateProgram = nullptr;
+static AttachShaderFn          realAttachShader = nullptr;
+static BindAttribLocationFn    realBindAttribLocation = nullptr;
+static ObjectFn                realLinkProgram = nullptr;
+static ObjectFn                realUseProgram = nullptr;
+static GetUniformLocationFn    realGetUniformLocation = nullptr;
+static Uniform1iFn             realUniform1i = nullptr;
+static VertexAttribPointerFn   realVertexAttribPointer = nullptr;
+static ObjectFn                realEnableVertexAttribArray = nullptr;
+static ObjectFn                realDisableVertexAttribArray = nullptr;
+static VertexAttribDivisorFn   realVertexAttribDivisor = nullptr;
+static DrawElementsInstancedFn realDrawElementsInstanced = nullptr;
+
+static void GLC_CALL hookGenBuffers(GLsizei n, GLuint* buffers) {
+    count(GLCALL_BUFFER);
+    realGenBuffers(n, buffers);
+    if (gLogFile) { op(OP_GEN_BUFFERS); putBytes(buffers, n * sizeof(GLuint)); }
+}
+
+static void GLC_CALL hookDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) { op(OP_DELETE_BUFFERS); putBytes(buffers, n * sizeof(GLuint)); }
+    realDeleteBuffers(n, buffers);
+}
+
+static void GLC_CALL hookBindBuffer(GLenum target, GLuint buffer) {
+    count(GLCALL_BUFFER);
+    if (target == GL_ARRAY_BUFFER) gArrayBuffer = buffer;
+    else if (target == GL_ELEMENT_ARRAY_BUFFER) gElementBuffer = buffer;
+    if (gLogFile) { op(OP_BIND_BUFFER); put(target); put(buffer); }
+    realBindBuffer(target, buffer);
+}
+
+static void GLC_CALL hookBufferData(GLenum target, ptrdiff_t size, const void* data, GLenum usage) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) {
+        op(OP_BUFFER_DATA);
+        put(target); put(usage);
+        put(static_cast<long long>(size));
+        putBytes(data, data ? size : 0);
+    }
+    realBufferData(target, size, data, usage);
+}
+
+static void GLC_CALL hookBufferSubData(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) {
+        op(OP_BUFFER_SUB_DATA);
+        put(target);
+        put(static_cast<long long>(offset));
+        putBytes(data, size);
+    }
+    realBufferSubData(target, offset, size, data);
+}
+
+static GLuint GLC_CALL hookCreateShader(GLenum type) {
+    count(GLCALL_SHADER);
+    GLuint shader = realCreateShader(type);
+    if (gLogFile) { op(OP_CREATE_SHADER); put(type); put(shader); }
+    return shader;
+}
+
+static void GLC_CALL hookShaderSource(GLuint shader, GLsizei n, const char* const* src, const GLint* length) {
+    count(GLCALL_SHADER);
+    if (gLogFile) {
+        // the pieces joined into one string
+        std::string text;
+        for (GLsizei i = 0; i < n; ++i) {
+            if (length && length[i] >= 0) text.append(src[i], length[i]);
+            else text.append(src[i]);
+        }
+        op(OP_SHADER_SOURCE);
+        put(shader);
+        putBytes(text.data(), text.size());
+    }
+    realShaderSource(shader, n, src, length);
+}
+
+static void GLC_CALL hookCompileShader(GLuint shader) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_COMPILE_SHADER); put(shader); }
+    realCompileShader(shader);
+}
+
+static void GLC_CALL hookDeleteShader(GLuint shader) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_DELETE_SHADER); put(shader); }
+    realDeleteShader(shader);
+}
+
+static GLuint GLC_CALL hookCreateProgram() {
+    count(GLCALL_SHADER);
+    GLuint program = realCreateProgram();
+    if (gLogFile) { op(OP_CREATE_PROGRAM); put(program); }
+    return program;
+}
+
+static void GLC_CALL hookAttachShader(GLuint program, GLuint shader) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_ATTACH_SHADER); put(program); put(shader); }
+    realAttachShader(program, shader);
+}
+
+static void GLC_CALL hookBindAttribLocation(GLuint program, GLuint index, const char* name) {
+    count(GLCALL_SHADER);
+    if (gLogFile) {
+        op(OP_BIND_ATTRIB_LOCATION);
+        put(program); put(index);
+        putBytes(name, std::strlen(name));
+    }
+    realBindAttribLocation(program, index, name);
+}
+
+static void GLC_CALL hookLinkProgram(GLuint program) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_LINK_PROGRAM); put(program); }
+    realLinkProgram(program);
+}
+
+static void GLC_CALL hookUseProgram(GLuint program) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_USE_PROGRAM); put(program); }
+    realUseProgram(program);
+}
+
+static GLint GLC_CALL hookGetUniformLocation(GLuint program, const char* name) {
+    count(GLCALL_SHADER);
+    GLint location = realGetUniformLocation(program, name);
+    if (gLogFile) {
+        op(OP_UNIFORM_LOCATION);
+        put(program); put(location);
+        putBytes(name, std::strlen(name));
+    }
+    return location;
+}
+
+static void GLC_CALL hookUniform1i(GLint location, GLint v0) {
+    count(GLCALL_SHADER);
+    if (gLogFile) { op(OP_UNIFORM1I); put(location); put(v0); }
+    realUniform1i(location, v0);
+}
+
+static void GLC_CALL hookVertexAttribPointer(GLuint index, GLint size, GLenum type,
+    GLboolean normalized, GLsizei stride, const void* pointer) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) {
+        static bool warned = false;
+        if (gArrayBuffer == 0 && !warned) {
+            printf("GL recording: client-side vertex attributes aren't recorded\n");
+            warned = true;
+        }
+        op(OP_VERTEX_ATTRIB_POINTER);
+        put(index); put(size); put(type); put(normalized); put(stride);
+        put(static_cast<unsigned long long>(reinterpret_cast<size_t>(pointer)));
+    }
+    realVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void GLC_CALL hookEnableVertexAttribArray(GLuint index) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) { op(OP_ENABLE_ATTRIB); put(index); }
+    realEnableVertexAttribArray(index);
+}
+
+static void GLC_CALL hookDisableVertexAttribArray(GLuint index) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) { op(OP_DISABLE_ATTRIB); put(index); }
+    realDisableVertexAttribArray(index);
+}
+
+static void GLC_CALL hookVertexAttribDivisor(GLuint index, GLuint divisor) {
+    count(GLCALL_BUFFER);
+    if (gLogFile) { op(OP_ATTRIB_DIVISOR); put(index); put(divisor); }
+    realVertexAttribDivisor(index, divisor);
+}
+
+static void GLC_CALL hookDrawElementsInstanced(GLenum mode, GLsizei n, GLenum type,
+    const void* indices, GLsizei instances) {
+    count(GLCALL_DRAW);
+    if (gLogFile) {
+        op(OP_DRAW_INSTANCED);
+        put(mode); put(n); put(type);
+        put(static_cast<unsigned long long>(reinterpret_cast<size_t>(indices)));
+        put(instances);
+    }
+    realDrawElementsInstanced(mode, n, type, indices, instances);
+}
+
+struct ProcHook {
+    const char* name;   // core name; "...ARB" matches too
+    void** real;
+    void* hook;
+};
+
+#define PROC_HOOK(fn) { "gl" #fn, reinterpret_cast<void**>(&real##fn), reinterpret_cast<void*>(&hook##fn) }
+static const ProcHook PROC_HOOKS[] = {
+    PROC_HOOK(GenBuffers), PROC_HOOK(DeleteBuffers), PROC_HOOK(BindBuffer),
+    PROC_HOOK(BufferData), PROC_HOOK(BufferSubData),
+    PROC_HOOK(CreateShader), PROC_HOOK(ShaderSource), PROC_HOOK(CompileShader),
+    PROC_HOOK(DeleteShader), PROC_HOOK(CreateProgram), PROC_HOOK(AttachShader),
+    PROC_HOOK(BindAttribLocation), PROC_HOOK(LinkProgram), PROC_HOOK(UseProgram),
+    PROC_HOOK(GetUniformLocation), PROC_HOOK(Uniform1i), PROC_HOOK(VertexAttribPointer),
+    PROC_HOOK(EnableVertexAttribArray), PROC_HOOK(DisableVertexAttribArray),
+    PROC_HOOK(VertexAttribDivisor), PROC_HOOK(DrawElementsInstanced)
+};
+#undef PROC_HOOK
+
+void* recordedGLProc(const char* name, void* proc) {
+    if (!proc) return nullptr;
+
+    size_t len = std::strlen(name);
+    if (len > 3 && std::strcmp(name + len - 3, "ARB") == 0) len -= 3;
+    for (const ProcHook& h : PROC_HOOKS) {
+        if (std::strlen(h.name) == len && std::strncmp(h.name, name, len) == 0) {
+            *h.real = proc;
+            return h.hook;
+        }
+    }
+    return proc;
+}
+
+// ---------- Replay ----------
+
+struct LogReader {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value = T();
+        if (end - p < static_cast<ptrdiff_t>(sizeof(T))) {
+            ok = false;
+            p = end;
+            return value;
+        }
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    // points into the log; null for an empty blob
+    const unsigned char* bytes(unsigned int& size) {
+        size = get<unsigned int>();
+        if (!ok || static_cast<size_t>(end - p) < size) {
+            ok = false;
+            p = end;
+            size = 0;
+            return nullptr;
+        }
+        const unsigned char* data = size ? p : nullptr;
+        p += size;
+        return data;
+    }
+};
+
+// recorded object name -> the one created on replay
+struct NameMap {
+    std::unordered_map<GLuint, GLuint> names;
+
+    GLuint operator()(GLuint recorded) const {
+        if (recorded == 0) return 0;
+        auto it = names.find(recorded);
+        return it != names.end() ? it->second : 0;
+    }
+};
+
+static const void* offsetPointer(unsigned long long offset) {
+    return reinterpret_cast<const void*>(static_cast<size_t>(offset));
+}
+
+unsigned long long hashGLFramebuffer(int width, int height) {
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    unsigned long long h = 1469598103934665603ull;
+    for (unsigned char c : pixels) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool replayGLLog(const std::string& path, GLReplayStats& out) {
+    out = GLReplayStats();
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        printf("Could not open GL log %s\n", path.c_str());
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+
+    LogReader in{ data.data(), data.data() + data.size() };
+    if (data.size() < 16 || std::memcmp(data.data(), GLLOG_MAGIC, 4) != 0) {
+        printf("%s is not a GL log\n", path.c_str());
+        return false;
+    }
+    in.p += 4;
+    int version = in.get<int>();
+    int width = in.get<int>();
+    int height = in.get<int>();
+    if (version != GLLOG_VERSION) {
+        printf("%s is GL log version %d, expected %d\n", path.c_str(), version, GLLOG_VERSION);
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    NameMap textures, buffers, lists, shaders, programs;
+    std::map<std::pair<GLuint, GLint>, GLint> uniforms;   // (recorded program, location)
+    GLuint currentProgram = 0;                            // recorded name
+    GLuint arrayBuffer = 0;                               // replay name
+    std::vector<unsigned char> clientArrays[ARRAY_KINDS];
+    bool warnedBuffers = false;
+
+    // count each replayed call like the wrappers do, frame 1 (loading) aside
+    GLCallStats frameCalls;
+    auto frameStart = std::chrono::steady_clock::now();
+
+    auto needBuffers = [&](bool have) {
+        if (!have && !warnedBuffers) {
+            printf("GL replay: log uses buffer / shader calls this context lacks\n");
+            warnedBuffers = true;
+        }
+        return have;
+    };
+
+    while (in.ok && in.p < in.end) {
+        GLOp code = static_cast<GLOp>(in.get<unsigned char>());
+        out.commands++;
+
+        switch (code) {
+        case OP_FRAME: {
+            auto submitted = std::chrono::steady_clock::now();
+            glFinish();
+            auto finished = std::chrono::steady_clock::now();
+            out.submitMs.push_back(std::chrono::duration<double, std::milli>(submitted - frameStart).count());
+            out.frameMs.push_back(std::chrono::duration<double, std::milli>(finished - frameStart).count());
+            if (out.frames > 0)
+                for (int c = 0; c < GLCALL_CATEGORIES; ++c) out.calls.calls[c] += frameCalls.calls[c];
+            frameCalls = GLCallStats();
+            out.frames++;
+            frameStart = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        case OP_ENABLE: glEnable(in.get<GLenum>()); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_DISABLE: glDisable(in.get<GLenum>()); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_ENABLE_CLIENT: glEnableClientState(in.get<GLenum>()); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_DISABLE_CLIENT: glDisableClientState(in.get<GLenum>()); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_COLOR3F: {
+            GLfloat r = in.get<GLfloat>(), g = in.get<GLfloat>(), b = in.get<GLfloat>();
+            glColor3f(r, g, b);
+            frameCalls.calls[GLCALL_STATE]++;
+            break;
+        }
+        case OP_LINE_WIDTH: glLineWidth(in.get<GLfloat>()); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_CLEAR_COLOR: {
+            GLfloat r = in.get<GLfloat>(), g = in.get<GLfloat>(), b = in.get<GLfloat>(), a = in.get<GLfloat>();
+            glClearColor(r, g, b, a);
+            frameCalls.calls[GLCALL_STATE]++;
+            break;
+        }
+        case OP_CLEAR: glClear(in.get<GLbitfield>()); frameCalls.calls[GLCALL_DRAW]++; break;
+        case OP_FLUSH: glFlush(); frameCalls.calls[GLCALL_STATE]++; break;
+        case OP_PIXEL_STORE: {
+            GLenum pname = in.get<GLenum>();
+            glPixelStorei(pname, in.get<GLint>());
+            frameCalls.calls[GLCALL_STATE]++;
+            break;
+        }
+        case OP_LIGHTFV: {
+            GLenum light = in.get<GLenum>(), pname = in.get<GLenum>();
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            GLfloat values[4] = { 0, 0, 0, 0 };
+            std::memcpy(values, p ? p : reinterpret_cast<const unsigned char*>(values),
+                std::min<size_t>(size, sizeof(values)));
+            glLightfv(light, pname, values);
+            frameCalls.calls[GLCALL_STATE]++;
+            break;
+        }
+
+        case OP_MATRIX_MODE: glMatrixMode(in.get<GLenum>()); frameCalls.calls[GLCALL_MATRIX]++; break;
+        case OP_LOAD_IDENTITY: glLoadIdentity(); frameCalls.calls[GLCALL_MATRIX]++; break;
+        case OP_LOAD_MATRIX: {
+            GLfloat m[16];
+            for (int i = 0; i < 16; ++i) m[i] = in.get<GLfloat>();
+            glLoadMatrixf(m);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+        case OP_PUSH_MATRIX: glPushMatrix(); frameCalls.calls[GLCALL_MATRIX]++; break;
+        case OP_POP_MATRIX: glPopMatrix(); frameCalls.calls[GLCALL_MATRIX]++; break;
+        case OP_TRANSLATE: {
+            GLfloat x = in.get<GLfloat>(), y = in.get<GLfloat>(), z = in.get<GLfloat>();
+            glTranslatef(x, y, z);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+        case OP_ROTATE: {
+            GLfloat a = in.get<GLfloat>(), x = in.get<GLfloat>(), y = in.get<GLfloat>(), z = in.get<GLfloat>();
+            glRotatef(a, x, y, z);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+        case OP_SCALE: {
+            GLfloat x = in.get<GLfloat>(), y = in.get<GLfloat>(), z = in.get<GLfloat>();
+            glScalef(x, y, z);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+        case OP_ORTHO2D: {
+            GLdouble v[4];
+            for (double& d : v) d = in.get<GLdouble>();
+            gluOrtho2D(v[0], v[1], v[2], v[3]);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+        case OP_LOOK_AT: {
+            GLdouble v[9];
+            for (double& d : v) d = in.get<GLdouble>();
+            gluLookAt(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8]);
+            frameCalls.calls[GLCALL_MATRIX]++;
+            break;
+        }
+
+        case OP_BEGIN: glBegin(in.get<GLenum>()); frameCalls.calls[GLCALL_VERTEX]++; break;
+        case OP_END: glEnd(); frameCalls.calls[GLCALL_VERTEX]++; break;
+        case OP_VERTEX3F: case OP_NORMAL3F: {
+            GLfloat x = in.get<GLfloat>(), y = in.get<GLfloat>(), z = in.get<GLfloat>();
+            if (code == OP_VERTEX3F) glVertex3f(x, y, z);
+            else glNormal3f(x, y, z);
+            frameCalls.calls[GLCALL_VERTEX]++;
+            break;
+        }
+        case OP_TEXCOORD2F: {
+            GLfloat u = in.get<GLfloat>(), v = in.get<GLfloat>();
+            glTexCoord2f(u, v);
+            frameCalls.calls[GLCALL_VERTEX]++;
+            break;
+        }
+        case OP_RASTER_POS2F: {
+            GLfloat x = in.get<GLfloat>(), y = in.get<GLfloat>();
+            glRasterPos2f(x, y);
+            frameCalls.calls[GLCALL_VERTEX]++;
+            break;
+        }
+        case OP_BITMAP_CHAR: {
+            int character = in.get<int>();
+            if (gGLUTWindow) glutBitmapCharacter(GLUT_BITMAP_8_BY_13, character);
+            else glBitmap(0, 0, 0, 0, 8, 0, nullptr);
+            frameCalls.calls[GLCALL_VERTEX]++;
+            break;
+        }
+        case OP_SOLID_CUBE: {
+            GLdouble size = in.get<GLdouble>();
+            if (gGLUTWindow) glutSolidCube(size);
+            else drawSolidCube(size);
+            frameCalls.calls[GLCALL_DRAW]++;
+            break;
+        }
+
+        case OP_GEN_TEXTURES: {
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            for (unsigned int i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+                GLuint recorded, created;
+                std::memcpy(&recorded, p + i, sizeof(GLuint));
+                glGenTextures(1, &created);
+                textures.names[recorded] = created;
+            }
+            frameCalls.calls[GLCALL_TEXTURE]++;
+            break;
+        }
+        case OP_BIND_TEXTURE: {
+            GLenum target = in.get<GLenum>();
+            glBindTexture(target, textures(in.get<GLuint>()));
+            frameCalls.calls[GLCALL_TEXTURE]++;
+            break;
+        }
+        case OP_TEX_PARAMETERI: {
+            GLenum target = in.get<GLenum>(), pname = in.get<GLenum>();
+            glTexParameteri(target, pname, in.get<GLint>());
+            frameCalls.calls[GLCALL_TEXTURE]++;
+            break;
+        }
+        case OP_TEX_IMAGE2D: {
+            GLenum target = in.get<GLenum>();
+            GLint level = in.get<GLint>(), internalFormat = in.get<GLint>();
+            GLsizei w = in.get<GLsizei>(), h = in.get<GLsizei>();
+            GLint border = in.get<GLint>();
+            GLenum format = in.get<GLenum>(), type = in.get<GLenum>();
+            unsigned int size;
+            const unsigned char* pixels = in.bytes(size);
+            glTexImage2D(target, level, internalFormat, w, h, border, format, type, pixels);
+            frameCalls.calls[GLCALL_TEXTURE]++;
+            break;
+        }
+        case OP_DELETE_TEXTURES: {
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            for (unsigned int i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+                GLuint recorded;
+                std::memcpy(&recorded, p + i, sizeof(GLuint));
+                GLuint name = textures(recorded);
+                if (name) glDeleteTextures(1, &name);
+                textures.names.erase(recorded);
+            }
+            frameCalls.calls[GLCALL_TEXTURE]++;
+            break;
+        }
+
+        case OP_GEN_LISTS: {
+            GLsizei range = in.get<GLsizei>();
+            GLuint recorded = in.get<GLuint>();
+            GLuint base = glGenLists(range);
+            for (GLsizei i = 0; i < range && recorded; ++i) lists.names[recorded + i] = base + i;
+            frameCalls.calls[GLCALL_LIST]++;
+            break;
+        }
+        case OP_NEW_LIST: {
+            GLuint list = lists(in.get<GLuint>());
+            glNewList(list, in.get<GLenum>());
+            frameCalls.calls[GLCALL_LIST]++;
+            break;
+        }
+        case OP_END_LIST: glEndList(); frameCalls.calls[GLCALL_LIST]++; break;
+        case OP_CALL_LIST: glCallList(lists(in.get<GLuint>())); frameCalls.calls[GLCALL_DRAW]++; break;
+        case OP_DELETE_LISTS: {
+            GLuint recorded = in.get<GLuint>();
+            GLsizei range = in.get<GLsizei>();
+            for (GLsizei i = 0; i < range; ++i) {
+                GLuint name = lists(recorded + i);
+                if (name) glDeleteLists(name, 1);
+                lists.names.erase(recorded + i);
+            }
+            frameCalls.calls[GLCALL_LIST]++;
+            break;
+        }
+
+        case OP_ARRAY_POINTER: case OP_CLIENT_ARRAY: {
+            int kind = in.get<unsigned char>();
+            GLint size = in.get<GLint>();
+            GLenum type = in.get<GLenum>();
+            GLsizei stride = in.get<GLsizei>();
+            const void* pointer;
+            if (code == OP_ARRAY_POINTER) {
+                pointer = offsetPointer(in.get<unsigned long long>());
+            }
+            else {
+                unsigned int bytes;
+                const unsigned char* p = in.bytes(bytes);
+                if (kind < 0 || kind >= ARRAY_KINDS) { in.ok = false; break; }
+                clientArrays[kind].assign(p, p + bytes);
+                pointer = clientArrays[kind].data();
+                if (arrayBuffer) realBindBuffer(GL_ARRAY_BUFFER, 0);
+            }
+
+            if (kind == ARRAY_VERTEX) glVertexPointer(size, type, stride, pointer);
+            else if (kind == ARRAY_NORMAL) glNormalPointer(type, stride, pointer);
+            else if (kind == ARRAY_TEXCOORD) glTexCoordPointer(size, type, stride, pointer);
+
+            if (code == OP_CLIENT_ARRAY && arrayBuffer) realBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
+            else frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_DRAW_ELEMENTS: {
+            GLenum mode = in.get<GLenum>();
+            GLsizei n = in.get<GLsizei>();
+            GLenum type = in.get<GLenum>();
+            bool inlineIndices = in.get<unsigned char>() != 0;
+            if (inlineIndices) {
+                unsigned int size;
+                const unsigned char* indices = in.bytes(size);
+                if (indices) glDrawElements(mode, n, type, indices);
+            }
+            else {
+                glDrawElements(mode, n, type, offsetPointer(in.get<unsigned long long>()));
+            }
+            frameCalls.calls[GLCALL_DRAW]++;
+            break;
+        }
+
+        case OP_GEN_BUFFERS: {
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            if (!needBuffers(realGenBuffers != nullptr)) break;
+            for (unsigned int i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+                GLuint recorded, created;
+                std::memcpy(&recorded, p + i, sizeof(GLuint));
+                realGenBuffers(1, &created);
+                buffers.names[recorded] = created;
+            }
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_DELETE_BUFFERS: {
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            if (!needBuffers(realDeleteBuffers != nullptr)) break;
+            for (unsigned int i = 0; i + sizeof(GLuint) <= size; i += sizeof(GLuint)) {
+                GLuint recorded;
+                std::memcpy(&recorded, p + i, sizeof(GLuint));
+                GLuint name = buffers(recorded);
+                if (name) realDeleteBuffers(1, &name);
+                buffers.names.erase(recorded);
+            }
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_BIND_BUFFER: {
+            GLenum target = in.get<GLenum>();
+            GLuint name = buffers(in.get<GLuint>());
+            if (!needBuffers(realBindBuffer != nullptr)) break;
+            if (target == GL_ARRAY_BUFFER) arrayBuffer = name;
+            realBindBuffer(target, name);
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_BUFFER_DATA: {
+            GLenum target = in.get<GLenum>(), usage = in.get<GLenum>();
+            long long size = in.get<long long>();
+            unsigned int bytes;
+            const unsigned char* p = in.bytes(bytes);
+            if (!needBuffers(realBufferData != nullptr)) break;
+            realBufferData(target, static_cast<ptrdiff_t>(size), p, usage);
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_BUFFER_SUB_DATA: {
+            GLenum target = in.get<GLenum>();
+            long long offset = in.get<long long>();
+            unsigned int bytes;
+            const unsigned char* p = in.bytes(bytes);
+            if (!needBuffers(realBufferSubData != nullptr)) break;
+            realBufferSubData(target, static_cast<ptrdiff_t>(offset), bytes, p);
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+
+        case OP_CREATE_SHADER: {
+            GLenum type = in.get<GLenum>();
+            GLuint recorded = in.get<GLuint>();
+            if (!needBuffers(realCreateShader != nullptr)) break;
+            shaders.names[recorded] = realCreateShader(type);
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_SHADER_SOURCE: {
+            GLuint shader = shaders(in.get<GLuint>());
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            if (!needBuffers(realShaderSource != nullptr)) break;
+            const char* text = reinterpret_cast<const char*>(p ? p : reinterpret_cast<const unsigned char*>(""));
+            GLint length = static_cast<GLint>(size);
+            realShaderSource(shader, 1, &text, &length);
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_COMPILE_SHADER: case OP_DELETE_SHADER: {
+            GLuint recorded = in.get<GLuint>();
+            ObjectFn fn = code == OP_COMPILE_SHADER ? realCompileShader : realDeleteShader;
+            if (!needBuffers(fn != nullptr)) break;
+            fn(shaders(recorded));
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_CREATE_PROGRAM: {
+            GLuint recorded = in.get<GLuint>();
+            if (!needBuffers(realCreateProgram != nullptr)) break;
+            programs.names[recorded] = realCreateProgram();
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_ATTACH_SHADER: {
+            GLuint program = programs(in.get<GLuint>());
+            GLuint shader = shaders(in.get<GLuint>());
+            if (!needBuffers(realAttachShader != nullptr)) break;
+            realAttachShader(program, shader);
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_BIND_ATTRIB_LOCATION: {
+            GLuint program = programs(in.get<GLuint>());
+            GLuint index = in.get<GLuint>();
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            if (!needBuffers(realBindAttribLocation != nullptr)) break;
+            std::string name(reinterpret_cast<const char*>(p ? p : reinterpret_cast<const unsigned char*>("")), size);
+            realBindAttribLocation(program, index, name.c_str());
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_LINK_PROGRAM: case OP_USE_PROGRAM: {
+            GLuint recorded = in.get<GLuint>();
+            ObjectFn fn = code == OP_LINK_PROGRAM ? realLinkProgram : realUseProgram;
+            if (!needBuffers(fn != nullptr)) break;
+            if (code == OP_USE_PROGRAM) currentProgram = recorded;
+            fn(programs(recorded));
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_UNIFORM_LOCATION: {
+            GLuint recorded = in.get<GLuint>();
+            GLint location = in.get<GLint>();
+            unsigned int size;
+            const unsigned char* p = in.bytes(size);
+            if (!needBuffers(realGetUniformLocation != nullptr)) break;
+            std::string name(reinterpret_cast<const char*>(p ? p : reinterpret_cast<const unsigned char*>("")), size);
+            uniforms[std::make_pair(recorded, location)] =
+                realGetUniformLocation(programs(recorded), name.c_str());
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+        case OP_UNIFORM1I: {
+            GLint location = in.get<GLint>(), value = in.get<GLint>();
+            if (!needBuffers(realUniform1i != nullptr)) break;
+            auto it = uniforms.find(std::make_pair(currentProgram, location));
+            realUniform1i(it != uniforms.end() ? it->second : -1, value);
+            frameCalls.calls[GLCALL_SHADER]++;
+            break;
+        }
+
+        case OP_VERTEX_ATTRIB_POINTER: {
+            GLuint index = in.get<GLuint>();
+            GLint size = in.get<GLint>();
+            GLenum type = in.get<GLenum>();
+            GLboolean normalized = in.get<GLboolean>();
+            GLsizei stride = in.get<GLsizei>();
+            unsigned long long offset = in.get<unsigned long long>();
+            if (!needBuffers(realVertexAttribPointer != nullptr)) break;
+            realVertexAttribPointer(index, size, type, normalized, stride, offsetPointer(offset));
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_ENABLE_ATTRIB: case OP_DISABLE_ATTRIB: {
+            GLuint index = in.get<GLuint>();
+            ObjectFn fn = code == OP_ENABLE_ATTRIB ? realEnableVertexAttribArray : realDisableVertexAttribArray;
+            if (!needBuffers(fn != nullptr)) break;
+            fn(index);
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_ATTRIB_DIVISOR: {
+            GLuint index = in.get<GLuint>(), divisor = in.get<GLuint>();
+            if (!needBuffers(realVertexAttribDivisor != nullptr)) break;
+            realVertexAttribDivisor(index, divisor);
+            frameCalls.calls[GLCALL_BUFFER]++;
+            break;
+        }
+        case OP_DRAW_INSTANCED: {
+            GLenum mode = in.get<GLenum>();
+            GLsizei count_ = in.get<GLsizei>();
+            GLenum type = in.get<GLenum>();
+            unsigned long long offset = in.get<unsigned long long>();
+            GLsizei instances = in.get<GLsizei>();
+            if (!needBuffers(realDrawElementsInstanced != nullptr)) break;
+            realDrawElementsInstanced(mode, count_, type, offsetPointer(offset), instances);
+            frameCalls.calls[GLCALL_DRAW]++;
+            break;
+        }
+
+        default:
+            printf("GL replay: unknown record %d at byte %d\n", static_cast<int>(code),
+                static_cast<int>(in.p - data.data() - 1));
+            return false;
+        }
+    }
+
+    if (!in.ok) {
+        printf("GL replay: %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    glFinish();
+    out.lastFrameHash = hashGLFramebuffer(width, height);
+    return true;
+}
@@ -0,0 +1,216 @@
+// glcalls.hpp
+#pragma once
+#include <string>
+#include <vector>
+
+#include <glut.h>
+
+// ---------- GL call layer ----------
+//
+// Every GL (and the few GLU / GLUT drawing) entry points the game calls go
+// through a thin wrapper: the #defines at the bottom redirect them in each
+// file that includes this header after <glut.h>. The buffer and shader
+// entry points gpumesh.cpp fetches at runtime are wrapped the same way,
+// by handing their addresses to recordedGLProc.
+//
+// Each wrapper counts the call under a category, for the frame's
+// statistics, and while a recording is running appends it to a binary
+// log before calling GL. The log starts at context creation, so the
+// textures, buffers, display lists and shaders later frames use are in it,
+// and a replay (against any context, e.g. Mesa's llvmpipe with
+// LIBGL_ALWAYS_SOFTWARE=1) needs nothing else.
+//
+// One thread only (GL is only called from the main thread).
+
+// False when GL runs without a GLUT window (--bench-gl): freeglut refuses
+// to draw before glutInit, so glutSolidCube is drawn here instead, with
+// the same faces and normals, and glutBitmapCharacter only advances the
+// raster position by the 8x13 font's width.
+extern bool gGLUTWindow;
+
+enum GLCallCategory {
+    GLCALL_STATE,      // enable / disable, colour, client state, pixel store
+    GLCALL_MATRIX,     // matrix stack, gluLookAt / gluOrtho2D
+    GLCALL_VERTEX,     // glBegin / glEnd and per-vertex calls, raster text
+    GLCALL_TEXTURE,    // create / bind / upload / parameters
+    GLCALL_BUFFER,     // buffer objects, array pointers, vertex attributes
+    GLCALL_SHADER,     // shader and program setup, uniforms
+    GLCALL_LIST,       // display list create / compile / delete
+    GLCALL_DRAW,       // glDrawElements (instanced), glCallList, glClear, glutSolidCube
+    GLCALL_QUERY,      // glGet*, glIsEnabled (counted, not recorded)
+    GLCALL_CATEGORIES
+};
+
+const char* glCallCategoryName(int category);
+
+struct GLCallStats {
+    int calls[GLCALL_CATEGORIES] = {};
+
+    int total() const;
+};
+
+// calls made during the last finished frame
+GLCallStats glCallStats();
+
+// Ends a frame: its counts become glCallStats(), and a recording gets a
+// frame marker (and is closed once it has all its frames). Call once at
+// the end of Display().
+void glCallsEndFrame();
+
+// ---------- Recording ----------
+//
+// Log format, native byte order: "GLRC", version, viewport width and
+// height (ints), then one record per call, an opcode byte followed by its
+// arguments as passed. Data GL reads through a pointer is copied in:
+// texture images, buffer contents, shader sources, and for draws from
+// client-side arrays the indices and the vertex range they use. Object
+// names (textures, buffers, lists, shaders, programs, uniform locations)
+// are recorded as the driver returned them and remapped on replay.
+
+// records from now until `frames` more frames have ended (or the program
+// exits); false if the file can't be created
+bool startGLRecording(const std::string& path, int frames, int width, int height);
+bool glRecording();
+
+// the buffer / shader entry point `name` (core or ARB) as returned by the
+// driver -> a wrapper that counts / records and then calls it (proc itself
+// for names the layer doesn't wrap, or if proc is null)
+void* recordedGLProc(const char* name, void* proc);
+
+// ---------- Replay ----------
+
+struct GLReplayStats {
+    int frames = 0;                  // frame markers reached
+    int commands = 0;                // records executed
+    std::vector<double> submitMs;    // per frame, issuing its calls
+    std::vector<double> frameMs;     // per frame, until glFinish returned
+    GLCallStats calls;               // all calls replayed after frame 1
+    unsigned long long lastFrameHash = 0;   // FNV-1a of the last frame's pixels
+};
+
+// Replays a log into the current context (which needs the buffer /
+// instancing entry points loaded if the recording used them). Frame 1
+// also creates every resource loaded before it. False on a bad or
+// truncated file.
+bool replayGLLog(const std::string& path, GLReplayStats& out);
+
+// FNV-1a of the current framebuffer's RGBA pixels
+unsigned long long hashGLFramebuffer(int width, int height);
+
+// ---------- Wrappers ----------
+
+void glcEnable(GLenum cap);
+void glcDisable(GLenum cap);
+void glcEnableClientState(GLenum array);
+void glcDisableClientState(GLenum array);
+void glcColor3f(GLfloat r, GLfloat g, GLfloat b);
+void glcLineWidth(GLfloat width);
+void glcClearColor(GLclampf r, GLclampf g, GLclampf b, GLclampf a);
+void glcClear(GLbitfield mask);
+void glcFlush();
+void glcPixelStorei(GLenum pname, GLint param);
+void glcLightfv(GLenum light, GLenum pname, const GLfloat* params);
+
+void glcMatrixMode(GLenum mode);
+void glcLoadIdentity();
+void glcLoadMatrixf(const GLfloat* m);
+void glcPushMatrix();
+void glcPopMatrix();
+void glcTranslatef(GLfloat x, GLfloat y, GLfloat z);
+void glcRotatef(GLfloat angle, GLfloat x, GLfloat y, GLfloat z);
+void glcScalef(GLfloat x, GLfloat y, GLfloat z);
+void glcOrtho2D(GLdouble left, GLdouble right, GLdouble bottom, GLdouble top);
+void glcLookAt(GLdouble eyeX, GLdouble eyeY, GLdouble eyeZ,
+    GLdouble centerX, GLdouble centerY, GLdouble centerZ,
+    GLdouble upX, GLdouble upY, GLdouble upZ);
+
+void glcBegin(GLenum mode);
+void glcEnd();
+void glcVertex3f(GLfloat x, GLfloat y, GLfloat z);
+void glcVertex3fv(const GLfloat* v);
+void glcNormal3fv(const GLfloat* v);
+void glcTexCoord2fv(const GLfloat* v);
+void glcRasterPos2f(GLfloat x, GLfloat y);
+void glcBitmapCharacter(void* font, int character);
+void glcSolidCube(GLdouble size);
+
+void glcGenTextures(GLsizei n, GLuint* textures);
+void glcBindTexture(GLenum target, GLuint texture);
+void glcTexParameteri(GLenum target, GLenum pname, GLint param);
+void glcTexImage2D(GLenum target, GLint level, GLint internalFormat,
+    GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type,
+    const GLvoid* pixels);
+void glcDeleteTextures(GLsizei n, const GLuint* textures);
+
+GLuint glcGenLists(GLsizei range);
+void glcNewList(GLuint list, GLenum mode);
+void glcEndList();
+void glcCallList(GLuint list);
+void glcDeleteLists(GLuint list, GLsizei range);
+
+void glcVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer);
+void glcNormalPointer(GLenum type, GLsizei stride, const GLvoid* pointer);
+void glcTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid* pointer);
+void glcDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+
+void glcGetFloatv(GLenum pname, GLfloat* params);
+void glcGetIntegerv(GLenum pname, GLint* params);
+GLboolean glcIsEnabled(GLenum cap);
+const GLubyte* glcGetString(GLenum name);
+
+#ifndef GLCALLS_NO_REDIRECT
+#define glEnable glcEnable
+#define glDisable glcDisable
+#define glEnableClientState glcEnableClientState
+#define glDisableClientState glcDisableClientState
+#define glColor3f glcColor3f
+#define glLineWidth glcLineWidth
+#define glClearColor glcClearColor
+#define glClear glcClear
+#define glFlush glcFlush
+#define glPixelStorei glcPixelStorei
+#define glLightfv glcLightfv
+
+#define glMatrixMode glcMatrixMode
+#define glLoadIdentity glcLoadIdentity
+#define glLoadMatrixf glcLoadMatrixf
+#define glPushMatrix glcPushMatrix
+#define glPopMatrix glcPopMatrix
+#define glTranslatef glcTranslatef
+#define glRotatef glcRotatef
+#define glScalef glcScalef
+#define gluOrtho2D glcOrtho2D
+#define gluLookAt glcLookAt
+
+#define glBegin glcBegin
+#define glEnd glcEnd
+#define glVertex3f glcVertex3f
+#define glVertex3fv glcVertex3fv
+#define glNormal3fv glcNormal3fv
+#define glTexCoord2fv glcTexCoord2fv
+#define glRasterPos2f glcRasterPos2f
+#define glutBitmapCharacter glcBitmapCharacter
+#define glutSolidCube glcSolidCube
+
+#define glGenTextures glcGenTextures
+#define glBindTexture glcBindTexture
+#define glTexParameteri glcTexParameteri
+#define glTexImage2D glcTexImage2D
+#define glDeleteTextures glcDeleteTextures
+
+#define glGenLists glcGenLists
+#define glNewList glcNewList
+#define glEndList glcEndList
+#define glCallList glcCallList
+#define glDeleteLists glcDeleteLists
+
+#define glVertexPointer glcVertexPointer
+#define glNormalPointer glcNormalPointer
+#define glTexCoordPointer glcTexCoordPointer
+#define glDrawElements glcDrawElements
+
+#define glGetFloatv glcGetFloatv
+#define glGetIntegerv glcGetIntegerv
+#define glIsEnabled glcIsEnabled
+#define glGetString glcGetString
+#endif
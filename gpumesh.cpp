@@ -0,0 +1,425 @@
+// gpumesh.cpp
+#include "gpumesh.hpp"
+#include "mesh.hpp"   // IndexBuffer
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <glut.h>
+#include "glcalls.hpp"
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+RenderPath gRenderPath = RENDER_VBO;
+
+// ---------- Entry points ----------
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STATIC_DRAW          0x88E4
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW          0x88E0
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER      0x8B30
+#define GL_VERTEX_SHADER        0x8B31
+#define GL_COMPILE_STATUS       0x8B81
+#define GL_LINK_STATUS          0x8B82
+#endif
+
+#ifdef _WIN32
+#define GLBUF_CALL __stdcall
+#else
+#define GLBUF_CALL
+#endif
+
+typedef void (GLBUF_CALL* GenBuffersFn)(GLsizei n, GLuint* buffers);
+typedef void (GLBUF_CALL* DeleteBuffersFn)(GLsizei n, const GLuint* buffers);
+typedef void (GLBUF_CALL* BindBufferFn)(GLenum target, GLuint buffer);
+typedef void (GLBUF_CALL* BufferDataFn)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (GLBUF_CALL* BufferSubDataFn)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+
+typedef GLuint(GLBUF_CALL* CreateShaderFn)(GLenum type);
+typedef void (GLBUF_CALL* ShaderSourceFn)(GLuint shader, GLsizei count, const char* const* src, const GLint* length);
+typedef void (GLBUF_CALL* CompileShaderFn)(GLuint shader);
+typedef void (GLBUF_CALL* GetShaderivFn)(GLuint shader, GLenum pname, GLint* params);
+typedef void (GLBUF_CALL* GetInfoLogFn)(GLuint object, GLsizei maxLength, GLsizei* length, char* log);
+typedef void (GLBUF_CALL* DeleteShaderFn)(GLuint shader);
+typedef GLuint(GLBUF_CALL* CreateProgramFn)();
+typedef void (GLBUF_CALL* AttachShaderFn)(GLuint program, GLuint shader);
+typedef void (GLBUF_CALL* BindAttribLocationFn)(GLuint program, GLuint index, const char* name);
+typedef void (GLBUF_CALL* LinkProgramFn)(GLuint program);
+typedef void (GLBUF_CALL* GetProgramivFn)(GLuint program, GLenum pname, GLint* params);
+typedef void (GLBUF_CALL* UseProgramFn)(GLuint program);
+typedef GLint(GLBUF_CALL* GetUniformLocationFn)(GLuint program, const char* name);
+typedef void (GLBUF_CALL* Uniform1iFn)(GLint location, GLint v0);
+typedef void (GLBUF_CALL* VertexAttribPointerFn)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef void (GLBUF_CALL* VertexAttribArrayFn)(GLuint index);
+typedef void (GLBUF_CALL* VertexAttribDivisorFn)(GLuint index, GLuint divisor);
+typedef void (GLBUF_CALL* DrawElementsInstancedFn)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+
+static GenBuffersFn    pGenBuffers = nullptr;
+static DeleteBuffersFn pDeleteBuffers = nullptr;
+static BindBufferFn    pBindBuffer = nullptr;
+static BufferDataFn    pBufferData = nullptr;
+static BufferSubDataFn pBufferSubData = nullptr;
+
+// wrapped by the GL call layer, so these are counted and recorded too
+static void* getGLProc(const char* name) {
+#ifdef _WIN32
+    void* p = reinterpret_cast<void*>(wglGetProcAddress(name));
+#else
+    void* p = reinterpret_cast<void*>(glXGetProcAddressARB(
+        reinterpret_cast<const GLubyte*>(name)));
+#endif
+    return recordedGLProc(name, p);
+}
+
+// core 1.5 name first, then the ARB extension
+static void* getGLProc2(const char* core, const char* arb) {
+    void* p = getGLProc(core);
+    return p ? p : getGLProc(arb);
+}
+
+bool loadGLBufferFunctions() {
+    pGenBuffers = reinterpret_cast<GenBuffersFn>(getGLProc2("glGenBuffers", "glGenBuffersARB"));
+    pDeleteBuffers = reinterpret_cast<DeleteBuffersFn>(getGLProc2("glDeleteBuffers", "glDeleteBuffersARB"));
+    pBindBuffer = reinterpret_cast<BindBufferFn>(getGLProc2("glBindBuffer", "glBindBufferARB"));
+    pBufferData = reinterpret_cast<BufferDataFn>(getGLProc2("glBufferData", "glBufferDataARB"));
+    pBufferSubData = reinterpret_cast<BufferSubDataFn>(getGLProc2("glBufferSubData", "glBufferSubDataARB"));
+
+    if (!glBuffersAvailable()) {
+        pGenBuffers = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool glBuffersAvailable() {
+    return pGenBuffers && pDeleteBuffers && pBindBuffer && pBufferData && pBufferSubData;
+}
+
+static CreateShaderFn          pCreateShader = nullptr;
+static ShaderSourceFn          pShaderSource = nullptr;
+static CompileShaderFn         pCompileShader = nullptr;
+static GetShaderivFn           pGetShaderiv = nullptr;
+static GetInfoLogFn            pGetShaderInfoLog = nullptr;
+static DeleteShaderFn          pDeleteShader = nullptr;
+static CreateProgramFn         pCreateProgram = nullptr;
+static AttachShaderFn          pAttachShader = nullptr;
+static BindAttribLocationFn    pBindAttribLocation = nullptr;
+static LinkProgramFn           pLinkProgram = nullptr;
+static GetProgramivFn          pGetProgramiv = nullptr;
+static GetInfoLogFn            pGetProgramInfoLog = nullptr;
+static UseProgramFn            pUseProgram = nullptr;
+static GetUniformLocationFn    pGetUniformLocation = nullptr;
+static Uniform1iFn             pUniform1i = nullptr;
+static VertexAttribPointerFn   pVertexAttribPointer = nullptr;
+static VertexAttribArrayFn     pEnableVertexAttribArray = nullptr;
+static VertexAttribArrayFn     pDisableVertexAttribArray = nullptr;
+static VertexAttribDivisorFn   pVertexAttribDivisor = nullptr;
+static DrawElementsInstancedFn pDrawElementsInstanced = nullptr;
+
+// ---------- Render path ----------
+
+const char* renderPathName(RenderPath path) {
+    switch (path) {
+    case RENDER_IMMEDIATE:    return "immediate";
+    case RENDER_DISPLAY_LIST: return "list";
+    default:                  return "vbo";
+    }
+}
+
+bool parseRenderPath(const char* name, RenderPath& out) {
+    for (int p = RENDER_IMMEDIATE; p <= RENDER_VBO; ++p) {
+        if (std::strcmp(name, renderPathName(static_cast<RenderPath>(p))) == 0) {
+            out = static_cast<RenderPath>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+void DisplayList::release() {
+    if (id) glDeleteLists(id, 1);
+    id = 0;
+}
+
+// ---------- VertexBuffers ----------
+
+bool VertexBuffers::upload(const std::vector<Vertex>& vertices,
+    const IndexBuffer& indices) {
+    release();
+    if (!glBuffersAvailable() || vertices.empty() || indices.empty()) return false;
+
+    pGenBuffers(1, &vbo);
+    pBindBuffer(GL_ARRAY_BUFFER, vbo);
+    pBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+        vertices.data(), GL_STATIC_DRAW);
+    pBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    indexCount = indices.size();
+    indices16 = indices.is16Bit();
+    pGenBuffers(1, &ibo);
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    if (indices16)
+        pBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.i16.size() * sizeof(unsigned short),
+            indices.i16.data(), GL_STATIC_DRAW);
+    else
+        pBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.i32.size() * sizeof(unsigned int),
+            indices.i32.data(), GL_STATIC_DRAW);
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    return true;
+}
+
+void VertexBuffers::draw(bool useTexcoords) const {
+    if (!vbo) return;
+
+    // with a buffer bound, the "pointers" are byte offsets into it
+    pBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex),
+        reinterpret_cast<const void*>(offsetof(Vertex, px)));
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, sizeof(Vertex),
+        reinterpret_cast<const void*>(offsetof(Vertex, nx)));
+    if (useTexcoords) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex),
+            reinterpret_cast<const void*>(offsetof(Vertex, u)));
+    }
+
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glDrawElements(GL_TRIANGLES, indexCount,
+        indices16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr);
+
+    if (useTexcoords) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    // client-array draws elsewhere expect no buffer bound
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    pBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void VertexBuffers::release() {
+    if (vbo && pDeleteBuffers) pDeleteBuffers(1, &vbo);
+    if (ibo && pDeleteBuffers) pDeleteBuffers(1, &ibo);
+    vbo = ibo = 0;
+    indexCount = 0;
+}
+
+// ---------- Instancing ----------
+
+bool gUseInstancing = true;
+
+// generic attribute slots for the two instance vec4s; 6 and 7 don't alias a
+// built-in attribute on drivers that alias them (NVIDIA)
+static const GLuint ATTRIB_INSTANCE_POS = 6;
+static const GLuint ATTRIB_INSTANCE_SCALE = 7;
+
+static GLuint gInstanceProgram = 0;
+static GLint  gInstanceTexturedLoc = -1;
+
+static const char* INSTANCE_VS =
+    "#version 110\n"
+    "attribute vec4 instancePos;     // x, y, z, ry (degrees)\n"
+    "attribute vec4 instanceScale;   // sx, sy, sz\n"
+    "void main() {\n"
+    "    vec3 p = gl_Vertex.xyz * instanceScale.xyz;\n"
+    "    float a = radians(instancePos.w);\n"
+    "    float c = cos(a), s = sin(a);\n"
+    "    p = vec3(c * p.x + s * p.z, p.y, c * p.z - s * p.x) + instancePos.xyz;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 1.0);\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+static const char* INSTANCE_FS =
+    "#version 110\n"
+    "uniform sampler2D tex;\n"
+    "uniform int textured;\n"
+    "void main() {\n"
+    "    vec4 c = gl_Color;\n"
+    "    if (textured != 0) c *= texture2D(tex, gl_TexCoord[0].st);\n"
+    "    gl_FragColor = c;\n"
+    "}\n";
+
+static GLuint compileShader(GLenum type, const char* src) {
+    GLuint shader = pCreateShader(type);
+    pShaderSource(shader, 1, &src, nullptr);
+    pCompileShader(shader);
+
+    GLint ok = 0;
+    pGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024] = "";
+        pGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        printf("Instancing shader failed to compile:\n%s\n", log);
+        pDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint buildInstanceProgram() {
+    GLuint vs = compileShader(GL_VERTEX_SHADER, INSTANCE_VS);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, INSTANCE_FS);
+    if (!vs || !fs) {
+        if (vs) pDeleteShader(vs);
+        if (fs) pDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = pCreateProgram();
+    pAttachShader(program, vs);
+    pAttachShader(program, fs);
+    pBindAttribLocation(program, ATTRIB_INSTANCE_POS, "instancePos");
+    pBindAttribLocation(program, ATTRIB_INSTANCE_SCALE, "instanceScale");
+    pLinkProgram(program);
+    pDeleteShader(vs);   // flagged, freed with the program
+    pDeleteShader(fs);
+
+    GLint ok = 0;
+    pGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024] = "";
+        pGetProgramInfoLog(program, sizeof(log), nullptr, log);
+        printf("Instancing shader failed to link:\n%s\n", log);
+        return 0;
+    }
+
+    pUseProgram(program);
+    pUniform1i(pGetUniformLocation(program, "tex"), 0);
+    gInstanceTexturedLoc = pGetUniformLocation(program, "textured");
+    pUseProgram(0);
+    return program;
+}
+
+bool loadInstancingFunctions() {
+    pCreateShader = reinterpret_cast<CreateShaderFn>(getGLProc("glCreateShader"));
+    pShaderSource = reinterpret_cast<ShaderSourceFn>(getGLProc("glShaderSource"));
+    pCompileShader = reinterpret_cast<CompileShaderFn>(getGLProc("glCompileShader"));
+    pGetShaderiv = reinterpret_cast<GetShaderivFn>(getGLProc("glGetShaderiv"));
+    pGetShaderInfoLog = reinterpret_cast<GetInfoLogFn>(getGLProc("glGetShaderInfoLog"));
+    pDeleteShader = reinterpret_cast<DeleteShaderFn>(getGLProc("glDeleteShader"));
+    pCreateProgram = reinterpret_cast<CreateProgramFn>(getGLProc("glCreateProgram"));
+    pAttachShader = reinterpret_cast<AttachShaderFn>(getGLProc("glAttachShader"));
+    pBindAttribLocation = reinterpret_cast<BindAttribLocationFn>(getGLProc("glBindAttribLocation"));
+    pLinkProgram = reinterpret_cast<LinkProgramFn>(getGLProc("glLinkProgram"));
+    pGetProgramiv = reinterpret_cast<GetProgramivFn>(getGLProc("glGetProgramiv"));
+    pGetProgramInfoLog = reinterpret_cast<GetInfoLogFn>(getGLProc("glGetProgramInfoLog"));
+    pUseProgram = reinterpret_cast<UseProgramFn>(getGLProc("glUseProgram"));
+    pGetUniformLocation = reinterpret_cast<GetUniformLocationFn>(getGLProc("glGetUniformLocation"));
+    pUniform1i = reinterpret_cast<Uniform1iFn>(getGLProc("glUniform1i"));
+    pVertexAttribPointer = reinterpret_cast<VertexAttribPointerFn>(getGLProc("glVertexAttribPointer"));
+    pEnableVertexAttribArray = reinterpret_cast<VertexAttribArrayFn>(getGLProc("glEnableVertexAttribArray"));
+    pDisableVertexAttribArray = reinterpret_cast<VertexAttribArrayFn>(getGLProc("glDisableVertexAttribArray"));
+    pVertexAttribDivisor = reinterpret_cast<VertexAttribDivisorFn>(
+        getGLProc2("glVertexAttribDivisor", "glVertexAttribDivisorARB"));
+    pDrawElementsInstanced = reinterpret_cast<DrawElementsInstancedFn>(
+        getGLProc2("glDrawElementsInstanced", "glDrawElementsInstancedARB"));
+
+    // glXGetProcAddress hands out pointers for names the driver doesn't
+    // implement, so the extension string decides for the instancing calls
+    const char* ext = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    bool gl33 = version && (version[0] > '3' || (version[0] == '3' && version[2] >= '3'));
+    bool hasExt = ext && std::strstr(ext, "GL_ARB_instanced_arrays") &&
+        std::strstr(ext, "GL_ARB_draw_instanced");
+
+    gInstanceProgram = 0;
+    if (!glBuffersAvailable() || !(gl33 || hasExt) ||
+        !pCreateShader || !pShaderSource || !pCompileShader || !pGetShaderiv ||
+        !pGetShaderInfoLog || !pDeleteShader || !pCreateProgram || !pAttachShader ||
+        !pBindAttribLocation || !pLinkProgram || !pGetProgramiv || !pGetProgramInfoLog ||
+        !pUseProgram || !pGetUniformLocation || !pUniform1i || !pVertexAttribPointer ||
+        !pEnableVertexAttribArray || !pDisableVertexAttribArray ||
+        !pVertexAttribDivisor || !pDrawElementsInstanced) {
+        return false;
+    }
+
+    gInstanceProgram = buildInstanceProgram();
+    return gInstanceProgram != 0;
+}
+
+bool instancingAvailable() {
+    return gInstanceProgram != 0;
+}
+
+void InstanceBuffer::update(const std::vector<InstanceTransform>& instances) {
+    count = static_cast<int>(instances.size());
+    if (!glBuffersAvailable() || instances.empty()) return;
+
+    if (!vbo) pGenBuffers(1, &vbo);
+    pBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // a fresh store each frame, so the driver needn't wait on last frame's draw
+    pBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceTransform),
+        instances.data(), GL_STREAM_DRAW);
+    pBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::release() {
+    if (vbo && pDeleteBuffers) pDeleteBuffers(1, &vbo);
+    vbo = 0;
+    count = 0;
+}
+
+bool drawInstanced(const VertexBuffers& buffers, const InstanceBuffer& instances,
+    bool useTexcoords) {
+    if (!gInstanceProgram || !buffers.uploaded() || !instances.vbo) return false;
+    if (instances.count == 0) return true;
+
+    pUseProgram(gInstanceProgram);
+    pUniform1i(gInstanceTexturedLoc, useTexcoords ? 1 : 0);
+
+    pBindBuffer(GL_ARRAY_BUFFER, instances.vbo);
+    pEnableVertexAttribArray(ATTRIB_INSTANCE_POS);
+    pVertexAttribPointer(ATTRIB_INSTANCE_POS, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform),
+        reinterpret_cast<const void*>(offsetof(InstanceTransform, x)));
+    pVertexAttribDivisor(ATTRIB_INSTANCE_POS, 1);
+    pEnableVertexAttribArray(ATTRIB_INSTANCE_SCALE);
+    pVertexAttribPointer(ATTRIB_INSTANCE_SCALE, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform),
+        reinterpret_cast<const void*>(offsetof(InstanceTransform, sx)));
+    pVertexAttribDivisor(ATTRIB_INSTANCE_SCALE, 1);
+
+    pBindBuffer(GL_ARRAY_BUFFER, buffers.vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex),
+        reinterpret_cast<const void*>(offsetof(Vertex, px)));
+    if (useTexcoords) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex),
+            reinterpret_cast<const void*>(offsetof(Vertex, u)));
+    }
+
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ibo);
+    pDrawElementsInstanced(GL_TRIANGLES, buffers.indexCount,
+        buffers.indices16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, nullptr, instances.count);
+
+    if (useTexcoords) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    // divisors are per attribute slot, not per program: reset them
+    pVertexAttribDivisor(ATTRIB_INSTANCE_POS, 0);
+    pVertexAttribDivisor(ATTRIB_INSTANCE_SCALE, 0);
+    pDisableVertexAttribArray(ATTRIB_INSTANCE_POS);
+    pDisableVertexAttribArray(ATTRIB_INSTANCE_SCALE);
+
+    pBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    pBindBuffer(GL_ARRAY_BUFFER, 0);
+    pUseProgram(0);
+    return true;
+}
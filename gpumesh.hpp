@@ -0,0 +1,106 @@
+// gpumesh.hpp
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "vertex.hpp"
+
+struct IndexBuffer;
+
+// ---------- Buffer objects ----------
+//
+// Vertex / index buffer objects (OpenGL 1.5 or ARB_vertex_buffer_object).
+// The Windows gl.h stops at 1.1, so the entry points are fetched at runtime
+// by loadGLBufferFunctions(), which needs a current context (call it after
+// glutCreateWindow, before loading meshes). Without them everything keeps
+// drawing from client-side arrays.
+//
+// No VAOs: they need GL 3.0 and the fixed-function client-state setup
+// below is a handful of calls per draw anyway.
+
+bool loadGLBufferFunctions();
+bool glBuffersAvailable();
+
+// ---------- Render path ----------
+//
+// How Mesh / SubMesh geometry goes to GL, switchable at runtime (--render,
+// 'm' in game) so the three can be compared on the same scene.
+
+enum RenderPath {
+    RENDER_IMMEDIATE,      // glBegin / glEnd, one call per attribute per vertex
+    RENDER_DISPLAY_LIST,   // compiled into a display list on first draw
+    RENDER_VBO             // buffer objects; client-side arrays if unavailable
+};
+
+extern RenderPath gRenderPath;
+
+const char* renderPathName(RenderPath path);
+bool parseRenderPath(const char* name, RenderPath& out);   // "immediate", "list", "vbo"
+
+// A display list compiled lazily by a const draw(), hence mutable.
+struct DisplayList {
+    mutable unsigned int id = 0;
+
+    void release();
+};
+
+// One mesh (or submesh) uploaded once at load time: its interleaved vertices
+// as they are in memory, and an index buffer. Handles are plain ints so
+// Mesh / SubMesh stay copyable; release() is explicit.
+struct VertexBuffers {
+    unsigned int vbo = 0;
+    unsigned int ibo = 0;
+    int indexCount = 0;
+    bool indices16 = false;
+
+    bool uploaded() const { return vbo != 0; }
+
+    // false (and nothing created) if buffers aren't available
+    bool upload(const std::vector<Vertex>& vertices,
+        const IndexBuffer& indices);
+    void draw(bool useTexcoords) const;
+    void release();
+};
+
+// ---------- Instancing ----------
+//
+// Many copies of one uploaded mesh in a single glDrawElementsInstanced
+// (GL 3.1 / ARB_draw_instanced), the per-copy transform stepped once per
+// instance by glVertexAttribDivisor (GL 3.3 / ARB_instanced_arrays).
+// Fixed function can't read per-instance data, so a small GLSL 1.10
+// program applies the transform and then the usual modelview / projection,
+// and outputs texture * glColor like the fixed-function path (the game
+// has no lighting). Entry points are loaded at runtime like the buffer
+// ones; without them callers draw copies one by one.
+
+// A GameObject's placement: translate(x, y, z) * rotateY(ry) * scale(sx, sy, sz)
+struct InstanceTransform {
+    float x, y, z;
+    float ry;              // degrees, as for glRotatef
+    float sx, sy, sz;
+    float pad;
+};
+
+static_assert(sizeof(InstanceTransform) == 32, "InstanceTransform is two vec4 attributes");
+
+// after loadGLBufferFunctions; also compiles the program
+bool loadInstancingFunctions();
+bool instancingAvailable();
+
+// false = always draw copies one by one (--no-instancing)
+extern bool gUseInstancing;
+
+// Per-type transforms, rewritten each frame (orphaned, GL_STREAM_DRAW).
+struct InstanceBuffer {
+    unsigned int vbo = 0;
+    int count = 0;
+
+    void update(const std::vector<InstanceTransform>& instances);
+    void release();
+};
+
+// Draws buffers.indexCount indices once per instance in `instances`,
+// relative to the current modelview; false (nothing drawn) if instancing
+// is unavailable or either side isn't uploaded.
+bool drawInstanced(const VertexBuffers& buffers, const InstanceBuffer& instances,
+    bool useTexcoords);
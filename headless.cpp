@@ -0,0 +1,131 @@
+// headless.cpp
+#include "headless.hpp"
+
+#ifndef _WIN32
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#endif
+
+#include <glut.h>
+
+#include <cstdio>
+
+#ifdef _WIN32
+
+bool createHeadlessContext(int width, int height) {
+    printf("No offscreen GL context in this build (needs EGL)\n");
+    return false;
+}
+
+#else
+
+// ---------- Framebuffer object entry points (GL 3.0 / ARB_framebuffer_object) ----------
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_RENDERBUFFER         0x8D41
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_DEPTH_ATTACHMENT     0x8D00
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24    0x81A6
+#endif
+
+typedef void (*GenObjectsFn)(GLsizei n, GLuint* names);
+typedef void (*BindObjectFn)(GLenum target, GLuint name);
+typedef void (*RenderbufferStorageFn)(GLenum target, GLenum format, GLsizei width, GLsizei height);
+typedef void (*FramebufferRenderbufferFn)(GLenum target, GLenum attachment, GLenum rbTarget, GLuint rb);
+typedef GLenum(*CheckFramebufferStatusFn)(GLenum target);
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+typedef EGLDisplay(*GetPlatformDisplayFn)(EGLenum platform, void* nativeDisplay, const EGLint* attribs);
+
+static EGLDisplay openDisplay() {
+    GetPlatformDisplayFn getPlatformDisplay = reinterpret_cast<GetPlatformDisplayFn>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+            EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY) return display;
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool createHeadlessContext(int width, int height) {
+    EGLDisplay display = openDisplay();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        printf("Offscreen GL: no EGL display\n");
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        printf("Offscreen GL: EGL %d.%d has no desktop OpenGL\n", major, minor);
+        return false;
+    }
+
+    // the surfaceless platform only lists pbuffer configs (the default
+    // surface type asked for is window)
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configs) || configs < 1) {
+        printf("Offscreen GL: no EGL config for OpenGL\n");
+        return false;
+    }
+
+    // no attributes: the legacy / compatibility profile the game is written for
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        printf("Offscreen GL: could not make a surfaceless context current\n");
+        return false;
+    }
+
+    GenObjectsFn genFramebuffers = reinterpret_cast<GenObjectsFn>(eglGetProcAddress("glGenFramebuffers"));
+    BindObjectFn bindFramebuffer = reinterpret_cast<BindObjectFn>(eglGetProcAddress("glBindFramebuffer"));
+    GenObjectsFn genRenderbuffers = reinterpret_cast<GenObjectsFn>(eglGetProcAddress("glGenRenderbuffers"));
+    BindObjectFn bindRenderbuffer = reinterpret_cast<BindObjectFn>(eglGetProcAddress("glBindRenderbuffer"));
+    RenderbufferStorageFn renderbufferStorage = reinterpret_cast<RenderbufferStorageFn>(
+        eglGetProcAddress("glRenderbufferStorage"));
+    FramebufferRenderbufferFn framebufferRenderbuffer = reinterpret_cast<FramebufferRenderbufferFn>(
+        eglGetProcAddress("glFramebufferRenderbuffer"));
+    CheckFramebufferStatusFn checkFramebufferStatus = reinterpret_cast<CheckFramebufferStatusFn>(
+        eglGetProcAddress("glCheckFramebufferStatus"));
+    if (!genFramebuffers || !bindFramebuffer || !genRenderbuffers || !bindRenderbuffer ||
+        !renderbufferStorage || !framebufferRenderbuffer || !checkFramebufferStatus) {
+        printf("Offscreen GL: no framebuffer objects\n");
+        return false;
+    }
+
+    GLuint framebuffer, renderbuffers[2];
+    genFramebuffers(1, &framebuffer);
+    bindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    genRenderbuffers(2, renderbuffers);
+
+    bindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+
+    bindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+    if (checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Offscreen GL: %dx%d framebuffer incomplete\n", width, height);
+        return false;
+    }
+
+    glViewport(0, 0, width, height);
+    printf("Offscreen GL: EGL %d.%d, %s, %s\n", major, minor,
+        (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+    return true;
+}
+
+#endif
@@ -0,0 +1,17 @@
+// headless.hpp
+#pragma once
+
+// ---------- Offscreen GL context ----------
+//
+// A GL context with no window, for running the normal GL renderer on a
+// machine without a display or GPU (Mesa's llvmpipe). It is a surfaceless
+// EGL context (EGL_MESA_platform_surfaceless, desktop GL, compatibility
+// profile) drawing into a framebuffer object of the given size, with a
+// colour and a depth buffer, bound for the rest of the run. Everything
+// that draws to or reads from the default framebuffer works unchanged.
+//
+// Linux only (link with -lEGL); elsewhere createHeadlessContext fails.
+// GLUT has no window in this mode, see gGLUTWindow in glcalls.hpp.
+
+// false with a message if no context could be made
+bool createHeadlessContext(int width, int height);
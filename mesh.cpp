@@ -1,121 +1,65 @@
 // Mesh.cpp
-#include "Mesh.hpp"
+#include "mesh.hpp"
+#include "meshcache.hpp"
+#include "objparse.hpp"
 
 // include glut first
 #include <glut.h>
+#include "glcalls.hpp"
 
-#include <cstdio>
-#include <cstring>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <map>
+#include <utility>
 #include <vector>
 
-struct Vec3 { float x, y, z; };
-struct Vec2 { float u, v; };
-
 Mesh loadOBJ(const std::string& path) {
     Mesh mesh;
 
-    FILE* f = std::fopen(path.c_str(), "r");
-    if (!f) {
-        std::cerr << "Could not open OBJ file: " << path << "\n";
+    if (readCookedMesh(path, mesh)) {
+        gCookedCacheStats.hits++;
+        std::cout << "Loaded " << path << " from cooked cache with "
+            << mesh.vertexCount() << " vertices\n";
+        mesh.uploadToGPU();
         return mesh;
     }
+    gCookedCacheStats.misses++;
 
-    std::vector<Vec3> tempV;
-    std::vector<Vec3> tempVN;
-    std::vector<Vec2> tempVT;
-
-    char line[512];
-
-    while (std::fgets(line, sizeof(line), f)) {
-
-        if (std::strncmp(line, "v ", 2) == 0) {
-            Vec3 v;
-            std::sscanf(line + 2, "%f %f %f", &v.x, &v.y, &v.z);
-            tempV.push_back(v);
-
-        }
-        else if (std::strncmp(line, "vn ", 3) == 0) {
-            Vec3 n;
-            std::sscanf(line + 3, "%f %f %f", &n.x, &n.y, &n.z);
-            tempVN.push_back(n);
-
-        }
-        else if (std::strncmp(line, "vt ", 3) == 0) {
-            Vec2 t;
-            std::sscanf(line + 3, "%f %f", &t.u, &t.v);
-            tempVT.push_back(t);
-
-        }
-        else if (std::strncmp(line, "f ", 2) == 0) {
-            // format: v/vt/vn v/vt/vn v/vt/vn
-            int vIdx[3], vtIdx[3], vnIdx[3];
-
-            int count = std::sscanf(
-                line + 2,
-                "%d/%d/%d %d/%d/%d %d/%d/%d",
-                &vIdx[0], &vtIdx[0], &vnIdx[0],
-                &vIdx[1], &vtIdx[1], &vnIdx[1],
-                &vIdx[2], &vtIdx[2], &vnIdx[2]
-            );
-
-            if (count < 9) {
-                // for faces that do not match this format we skip for now
-                continue;
-            }
-
-            for (int i = 0; i < 3; ++i) {
-                int vi = vIdx[i] - 1;   // OBJ is 1-based
-                int ni = vnIdx[i] - 1;
-                int ti = vtIdx[i] - 1;
-
-                const Vec3& v = tempV[vi];
-                mesh.vertices.push_back(v.x);
-                mesh.vertices.push_back(v.y);
-                mesh.vertices.push_back(v.z);
-
-                // normals
-                if (!tempVN.empty() && ni >= 0 && ni < (int)tempVN.size()) {
-                    const Vec3& n = tempVN[ni];
-                    mesh.normals.push_back(n.x);
-                    mesh.normals.push_back(n.y);
-                    mesh.normals.push_back(n.z);
-                }
-                else {
-                    mesh.normals.push_back(0.0f);
-                    mesh.normals.push_back(1.0f);
-                    mesh.normals.push_back(0.0f);
-                }
-
-                // texcoords
-                if (!tempVT.empty() && ti >= 0 && ti < (int)tempVT.size()) {
-                    const Vec2& t = tempVT[ti];
-                    mesh.texcoords.push_back(t.u);
-                    mesh.texcoords.push_back(t.v);
-                }
-                else {
-                    mesh.texcoords.push_back(0.0f);
-                    mesh.texcoords.push_back(0.0f);
-                }
-            }
-        }
-
-
+    ObjData obj;
+    if (!parseOBJFile(path, obj)) {
+        std::cerr << "Could not open OBJ file: " << path << "\n";
+        return mesh;
     }
 
-    std::fclose(f);
+    // usemtl groups don't matter for a plain Mesh: take every face in file order
+    std::vector<int> groups;
+    for (size_t g = 0; g < obj.groups.size(); ++g)
+        groups.push_back(static_cast<int>(g));
 
-    std::cout << "Loaded " << path << " with "
-        << mesh.vertexCount() << " vertices\n";
+    std::vector<unsigned int> indices;
+    indexCorners(obj, groups, mesh.vertices, indices);
+    mesh.indices.assign(indices, mesh.vertexCount());
+
+    // what the old one-vertex-per-corner layout would have cost
+    size_t expandedBytes = indices.size() * sizeof(Vertex);
+    size_t indexedBytes = mesh.vertexCount() * sizeof(Vertex) +
+        mesh.indices.byteSize();
 
     mesh.computeBounds();
     std::cout << "Loaded " << path << " with "
-        << mesh.vertexCount() << " vertices. "
-        << "Size: "
+        << mesh.vertexCount() << " unique vertices, "
+        << mesh.triangleCount() << " triangles ("
+        << indexedBytes / 1024 << " KB indexed vs "
+        << expandedBytes / 1024 << " KB expanded), size "
         << (mesh.maxX - mesh.minX) << " x "
         << (mesh.maxY - mesh.minY) << " x "
         << (mesh.maxZ - mesh.minZ) << "\n";
 
+    if (!writeCookedMesh(path, mesh))
+        std::cerr << "Could not write cooked mesh for " << path << "\n";
+
+    mesh.uploadToGPU();
     return mesh;
 }
 
@@ -125,15 +69,14 @@ void Mesh::computeBounds() {
         return;
     }
 
-    minX = maxX = vertices[0];
-    minY = maxY = vertices[1];
-    minZ = maxZ = vertices[2];
+    minX = maxX = vertices[0].px;
+    minY = maxY = vertices[0].py;
+    minZ = maxZ = vertices[0].pz;
 
-    int n = vertexCount();
-    for (int i = 1; i < n; ++i) {
-        float x = vertices[3 * i + 0];
-        float y = vertices[3 * i + 1];
-        float z = vertices[3 * i + 2];
+    for (const Vertex& v : vertices) {
+        float x = v.px;
+        float y = v.py;
+        float z = v.pz;
 
         if (x < minX) minX = x;
         if (x > maxX) maxX = x;
@@ -146,26 +89,214 @@ void Mesh::computeBounds() {
     hasBounds = true;
 }
 
+float Mesh::boundingRadius() const {
+    if (!hasBounds) return 0.0f;
+    float x = std::max(std::fabs(minX), std::fabs(maxX));
+    float y = std::max(std::fabs(minY), std::fabs(maxY));
+    float z = std::max(std::fabs(minZ), std::fabs(maxZ));
+    return std::sqrt(x * x + y * y + z * z);
+}
+
 
-void Mesh::draw(bool useTexcoords) const {
-    if (vertices.empty()) return;
+// ---------- Index buffer ----------
+
+void IndexBuffer::assign(const std::vector<unsigned int>& idx, int vertexCount) {
+    i16.clear();
+    i32.clear();
+
+    if (vertexCount <= 65536) {
+        i16.assign(idx.begin(), idx.end());
+    }
+    else {
+        i32 = idx;
+    }
+}
+
+std::vector<unsigned int> IndexBuffer::toVector() const {
+    if (!i16.empty())
+        return std::vector<unsigned int>(i16.begin(), i16.end());
+    return i32;
+}
+
+void drawIndexedArrays(const Vertex* vertices, const IndexBuffer& indices,
+    bool useTexcoords) {
+    if (!vertices || indices.empty()) return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &vertices->px);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), &vertices->nx);
+    if (useTexcoords) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &vertices->u);
+    }
+
+    if (indices.is16Bit())
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_SHORT, indices.i16.data());
+    else
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, indices.i32.data());
+
+    if (useTexcoords) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void drawIndexedImmediate(const Vertex* vertices, const IndexBuffer& indices,
+    bool useTexcoords) {
+    if (!vertices || indices.empty()) return;
 
     glBegin(GL_TRIANGLES);
-    int nVerts = vertexCount();
+    int n = indices.size();
+    for (int i = 0; i < n; ++i) {
+        const Vertex& v = vertices[indices[i]];
+        glNormal3fv(&v.nx);
+        if (useTexcoords) glTexCoord2fv(&v.u);
+        glVertex3fv(&v.px);
+    }
+    glEnd();
+}
+
+void drawIndexedGeometry(const std::vector<Vertex>& vertices,
+    const IndexBuffer& indices,
+    const VertexBuffers& gpu,
+    const DisplayList& list,
+    bool useTexcoords) {
+    const Vertex* v = vertices.empty() ? nullptr : vertices.data();
+
+    switch (gRenderPath) {
+    case RENDER_IMMEDIATE:
+        drawIndexedImmediate(v, indices, useTexcoords);
+        break;
+
+    case RENDER_DISPLAY_LIST:
+        if (!list.id) {
+            // texcoords are ignored with texturing off, so one list serves both
+            list.id = glGenLists(1);
+            glNewList(list.id, GL_COMPILE);
+            drawIndexedArrays(v, indices, true);
+            glEndList();
+        }
+        glCallList(list.id);
+        break;
+
+    case RENDER_VBO:
+        if (gpu.uploaded())
+            gpu.draw(useTexcoords);
+        else
+            drawIndexedArrays(v, indices, useTexcoords);
+        break;
+    }
+}
+
+// ---------- Plane clipping ----------
+
+static Vertex lerpVertex(const Vertex& a, const Vertex& b, float t) {
+    Vertex v;
+    v.px = a.px + (b.px - a.px) * t;
+    v.py = a.py + (b.py - a.py) * t;
+    v.pz = a.pz + (b.pz - a.pz) * t;
+    v.nx = a.nx + (b.nx - a.nx) * t;
+    v.ny = a.ny + (b.ny - a.ny) * t;
+    v.nz = a.nz + (b.nz - a.nz) * t;
+    v.u = a.u + (b.u - a.u) * t;
+    v.v = a.v + (b.v - a.v) * t;
+
+    float len = std::sqrt(v.nx * v.nx + v.ny * v.ny + v.nz * v.nz);
+    if (len > 0.0f) {
+        v.nx /= len;
+        v.ny /= len;
+        v.nz /= len;
+    }
+    return v;
+}
+
+int Mesh::clipToPlane(const float plane[4]) {
+    if (vertices.empty()) return 0;
+
+    std::vector<float> dist(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        dist[i] = plane[0] * v.px + plane[1] * v.py + plane[2] * v.pz + plane[3];
+    }
+
+    // kept vertices are renumbered; a cut edge gets one new vertex shared by
+    // the triangles on both sides of it, so the cut stays watertight
+    std::vector<Vertex> out;
+    std::vector<int> remap(vertices.size(), -1);
+    std::map<std::pair<unsigned int, unsigned int>, unsigned int> edgeVertex;
+
+    auto keep = [&](unsigned int i) -> unsigned int {
+        if (remap[i] < 0) {
+            remap[i] = static_cast<int>(out.size());
+            out.push_back(vertices[i]);
+        }
+        return static_cast<unsigned int>(remap[i]);
+    };
+    auto cut = [&](unsigned int a, unsigned int b) -> unsigned int {
+        std::pair<unsigned int, unsigned int> edge(std::min(a, b), std::max(a, b));
+        auto it = edgeVertex.find(edge);
+        if (it != edgeVertex.end()) return it->second;
+
+        // interpolate from the lower index so both sides get the same bits
+        unsigned int from = edge.first, to = edge.second;
+        float t = dist[from] / (dist[from] - dist[to]);
+        unsigned int id = static_cast<unsigned int>(out.size());
+        out.push_back(lerpVertex(vertices[from], vertices[to], t));
+        edgeVertex[edge] = id;
+        return id;
+    };
+
+    std::vector<unsigned int> idx;
+    int split = 0;
+    int n = indices.size();
+    for (int t = 0; t + 2 < n; t += 3) {
+        unsigned int tri[3] = { indices[t], indices[t + 1], indices[t + 2] };
+        int inside = 0;
+        for (int k = 0; k < 3; ++k)
+            if (dist[tri[k]] >= 0.0f) ++inside;
+
+        if (inside == 0) continue;
+        if (inside == 3) {
+            for (int k = 0; k < 3; ++k) idx.push_back(keep(tri[k]));
+            continue;
+        }
 
-    for (int i = 0; i < nVerts; ++i) {
-        if (!normals.empty()) {
-            glNormal3f(normals[3 * i + 0],
-                normals[3 * i + 1],
-                normals[3 * i + 2]);
+        // walk the edges in order (Sutherland-Hodgman): 3 or 4 corners,
+        // winding preserved, fanned back into triangles
+        unsigned int poly[4];
+        int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            unsigned int a = tri[k], b = tri[(k + 1) % 3];
+            bool aIn = dist[a] >= 0.0f, bIn = dist[b] >= 0.0f;
+            if (aIn) poly[count++] = keep(a);
+            if (aIn != bIn) poly[count++] = cut(a, b);
         }
-        if (useTexcoords && !texcoords.empty()) {
-            glTexCoord2f(texcoords[2 * i + 0],
-                texcoords[2 * i + 1]);
+        for (int k = 1; k + 1 < count; ++k) {
+            idx.push_back(poly[0]);
+            idx.push_back(poly[k]);
+            idx.push_back(poly[k + 1]);
         }
-        glVertex3f(vertices[3 * i + 0],
-            vertices[3 * i + 1],
-            vertices[3 * i + 2]);
+        ++split;
     }
-    glEnd();
+
+    bool wasUploaded = gpu.uploaded();
+    gpu.release();
+    list.release();
+
+    vertices.swap(out);
+    indices.assign(idx, vertexCount());
+    computeBounds();
+
+    if (wasUploaded) uploadToGPU();
+    return split;
+}
+
+void Mesh::uploadToGPU() {
+    gpu.upload(vertices, indices);
+}
+
+void Mesh::draw(bool useTexcoords) const {
+    if (vertices.empty()) return;
+
+    drawIndexedGeometry(vertices, indices, gpu, list, useTexcoords);
 }
@@ -2,12 +2,59 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <cstddef>
 
+#include "gpumesh.hpp"
+#include "vertex.hpp"
+
+// Triangle-list indices. Stored as 16-bit when every index fits, 32-bit
+// otherwise; only one of the two vectors is ever filled.
+struct IndexBuffer {
+    std::vector<unsigned short> i16;
+    std::vector<unsigned int>   i32;
+
+    int size() const {
+        return static_cast<int>(i16.empty() ? i32.size() : i16.size());
+    }
+    bool empty() const { return i16.empty() && i32.empty(); }
+    bool is16Bit() const { return !i16.empty(); }
+
+    unsigned int operator[](int i) const {
+        return i16.empty() ? i32[i] : i16[i];
+    }
+
+    size_t byteSize() const {
+        return i16.size() * sizeof(unsigned short) +
+            i32.size() * sizeof(unsigned int);
+    }
+
+    // picks 16-bit storage when vertexCount allows it
+    void assign(const std::vector<unsigned int>& idx, int vertexCount);
+    std::vector<unsigned int> toVector() const;
+};
+
+// glDrawElements over client-side (interleaved) arrays
+void drawIndexedArrays(const Vertex* vertices, const IndexBuffer& indices,
+    bool useTexcoords);
+
+// the same triangles with glBegin / glEnd
+void drawIndexedImmediate(const Vertex* vertices, const IndexBuffer& indices,
+    bool useTexcoords);
+
+// Draws with gRenderPath: immediate mode, the display list (compiled on
+// first use, texcoords always included) or the buffers if uploaded.
+void drawIndexedGeometry(const std::vector<Vertex>& vertices,
+    const IndexBuffer& indices,
+    const VertexBuffers& gpu,
+    const DisplayList& list,
+    bool useTexcoords);
 
 struct Mesh {
-    std::vector<float> vertices;
-    std::vector<float> normals;
-    std::vector<float> texcoords;
+    // unique vertices (an OBJ v/vt/vn triplet is stored once)
+    std::vector<Vertex> vertices;
+    IndexBuffer indices;
+    VertexBuffers gpu;             // filled by uploadToGPU, if buffers are available
+    DisplayList list;              // RENDER_DISPLAY_LIST
 
     // bounding box
     float minX = 0, maxX = 0;
@@ -16,11 +63,25 @@ struct Mesh {
     bool  hasBounds = false;
 
     int vertexCount() const {
-        return static_cast<int>(vertices.size() / 3);
+        return static_cast<int>(vertices.size());
+    }
+    int triangleCount() const {
+        return indices.size() / 3;
     }
 
     void computeBounds();
+    void uploadToGPU();
     void draw(bool useTexcoords = true) const;
+
+    // Cuts the mesh once against a plane in its local space, keeping points
+    // with a*x + b*y + c*z + d >= 0: triangles across it are split there
+    // (new vertices interpolate every attribute), the rest kept or dropped.
+    // Bounds are recomputed and uploaded buffers / display list rebuilt.
+    // Returns how many triangles were split.
+    int clipToPlane(const float plane[4]);
+
+    // sphere around the mesh origin that holds the bounding box
+    float boundingRadius() const;
 };
 
 
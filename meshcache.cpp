@@ -0,0 +1,495 @@
+// meshcache.cpp
+#include "meshcache.hpp"
+#include "assetpack.hpp"
+#include "objparse.hpp"   // MappedFile
+
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <utility>
+
+CookedCacheStats gCookedCacheStats;
+
+// every cooked file read or written this run (the asset pack's contents)
+static std::mutex gCookedFilesLock;
+static std::set<std::string> gCookedFiles;
+
+static const char COOKED_MAGIC[4] = { 'D', 'M', 'C', 'K' };
+
+enum CookedKind {
+    COOKED_MESH = 1,
+    COOKED_MODEL = 2,
+    COOKED_TEXTURE = 3
+};
+
+// one source file the cooked data was built from
+struct CookedSource {
+    std::string path;
+    unsigned long long size = 0;
+    long long mtime = 0;
+    unsigned long long hash = 0;
+};
+
+// ---------- Helpers ----------
+
+static std::string cookedPathFor(const std::string& objPath) {
+    return objPath + ".cooked";
+}
+
+static bool statFile(const std::string& path,
+    unsigned long long& size, long long& mtime) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+#endif
+    size = static_cast<unsigned long long>(st.st_size);
+    mtime = static_cast<long long>(st.st_mtime);
+    return true;
+}
+
+bool hashFileContents(const std::string& path, unsigned long long& outHash) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    unsigned long long h = 14695981039346656037ULL;   // FNV offset basis
+    unsigned char buf[64 * 1024];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            h ^= buf[i];
+            h *= 1099511628211ULL;                      // FNV prime
+        }
+    }
+    std::fclose(f);
+
+    outHash = h;
+    return true;
+}
+
+static bool describeSource(const std::string& path, CookedSource& out) {
+    out.path = path;
+    if (!statFile(path, out.size, out.mtime)) return false;
+    return hashFileContents(path, out.hash);
+}
+
+// ---------- Raw binary I/O ----------
+
+template <typename T>
+static void writePod(FILE* f, const T& v) {
+    std::fwrite(&v, sizeof(T), 1, f);
+}
+
+// cooked bytes being read: a mapped .cooked file or an asset pack entry
+struct CookedReader {
+    MappedFile file;                    // unused for pack entries
+    const unsigned char* p = nullptr;
+    const unsigned char* end = nullptr;
+    bool packed = false;                // from the pack: sources aren't re-checked
+
+    size_t left() const { return static_cast<size_t>(end - p); }
+
+    bool read(void* dst, size_t n) {
+        if (n > left()) return false;
+        if (n) std::memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+    bool skip(size_t n) {
+        if (n > left()) return false;
+        p += n;
+        return true;
+    }
+};
+
+template <typename T>
+static bool readPod(CookedReader& r, T& v) {
+    return r.read(&v, sizeof(T));
+}
+
+static void writeString(FILE* f, const std::string& s) {
+    writePod(f, static_cast<unsigned int>(s.size()));
+    if (!s.empty()) std::fwrite(s.data(), 1, s.size(), f);
+}
+
+static bool readString(CookedReader& r, std::string& s) {
+    unsigned int len = 0;
+    if (!readPod(r, len) || len > 4096) return false;
+    s.resize(len);
+    return len == 0 || r.read(&s[0], len);
+}
+
+// Vertex is 8 floats with no padding, so the array is written as it is in memory
+static void writeVertices(FILE* f, const std::vector<Vertex>& v) {
+    writePod(f, static_cast<unsigned int>(v.size()));
+    if (!v.empty()) std::fwrite(v.data(), sizeof(Vertex), v.size(), f);
+}
+
+static bool readVertices(CookedReader& r, std::vector<Vertex>& v) {
+    unsigned int count = 0;
+    if (!readPod(r, count)) return false;
+    if ((unsigned long long)count * sizeof(Vertex) > r.left()) return false;  // corrupt
+    v.resize(count);
+    return count == 0 || r.read(v.data(), count * sizeof(Vertex));
+}
+
+static void writeIndices(FILE* f, const IndexBuffer& ib) {
+    unsigned char width = ib.is16Bit() ? 2 : 4;
+    writePod(f, width);
+    writePod(f, static_cast<unsigned int>(ib.size()));
+    if (ib.is16Bit())
+        std::fwrite(ib.i16.data(), sizeof(unsigned short), ib.i16.size(), f);
+    else if (!ib.i32.empty())
+        std::fwrite(ib.i32.data(), sizeof(unsigned int), ib.i32.size(), f);
+}
+
+static bool readIndices(CookedReader& r, IndexBuffer& ib) {
+    unsigned char width = 0;
+    unsigned int count = 0;
+    if (!readPod(r, width) || !readPod(r, count)) return false;
+    if (width != 2 && width != 4) return false;
+    if ((unsigned long long)count * width > r.left()) return false;  // corrupt
+
+    ib.i16.clear();
+    ib.i32.clear();
+    if (count == 0) return true;
+    if (width == 2) {
+        ib.i16.resize(count);
+        return r.read(ib.i16.data(), count * sizeof(unsigned short));
+    }
+    ib.i32.resize(count);
+    return r.read(ib.i32.data(), count * sizeof(unsigned int));
+}
+
+// ---------- Header ----------
+
+static void writeHeader(FILE* f, CookedKind kind, unsigned int flags,
+    const std::vector<CookedSource>& sources) {
+    std::fwrite(COOKED_MAGIC, 1, 4, f);
+    writePod(f, COOKED_MESH_VERSION);
+    writePod(f, static_cast<unsigned int>(kind));
+    writePod(f, flags);
+    writePod(f, static_cast<unsigned int>(sources.size()));
+
+    for (const auto& s : sources) {
+        writeString(f, s.path);
+        writePod(f, s.size);
+        writePod(f, s.mtime);
+        writePod(f, s.hash);
+    }
+}
+
+// checks magic / version / kind / flags and that every source is unchanged
+// (packed files are trusted: the pack is what ships, sources may not)
+static bool readAndValidateHeader(CookedReader& r, CookedKind kind, unsigned int flags,
+    const std::string& objPath) {
+    char magic[4];
+    unsigned int version = 0, fileKind = 0, fileFlags = 0, sourceCount = 0;
+
+    if (!r.read(magic, 4)) return false;
+    if (std::memcmp(magic, COOKED_MAGIC, 4) != 0) return false;
+    if (!readPod(r, version) || version != COOKED_MESH_VERSION) return false;
+    if (!readPod(r, fileKind) || fileKind != (unsigned int)kind) return false;
+    if (!readPod(r, fileFlags) || fileFlags != flags) return false;
+    if (!readPod(r, sourceCount) || sourceCount == 0 || sourceCount > 16) return false;
+
+    for (unsigned int i = 0; i < sourceCount; ++i) {
+        CookedSource s;
+        if (!readString(r, s.path)) return false;
+        if (!readPod(r, s.size) || !readPod(r, s.mtime) || !readPod(r, s.hash))
+            return false;
+
+        // the first source is always the file that was cooked
+        if (i == 0 && s.path != objPath) return false;
+        if (r.packed) continue;
+
+        unsigned long long size = 0;
+        long long mtime = 0;
+        if (!statFile(s.path, size, mtime)) return false;
+        if (size != s.size) return false;
+
+        if (mtime != s.mtime) {
+            // touched but maybe not changed: fall back to the content hash
+            unsigned long long hash = 0;
+            if (!hashFileContents(s.path, hash) || hash != s.hash)
+                return false;
+        }
+    }
+    return true;
+}
+
+static void noteCookedFile(const std::string& cookedPath) {
+    std::lock_guard<std::mutex> l(gCookedFilesLock);
+    gCookedFiles.insert(cookedPath);
+}
+
+// asset pack entry if there is one, else the loose .cooked file (mapped)
+static bool openCookedForRead(const std::string& objPath, CookedReader& r) {
+    std::string cooked = cookedPathFor(objPath);
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    if (findPackedAsset(cooked, data, size)) {
+        r.p = data;
+        r.end = data + size;
+        r.packed = true;
+        return true;
+    }
+
+    if (!r.file.open(cooked) || !r.file.data) return false;
+    r.p = reinterpret_cast<const unsigned char*>(r.file.data);
+    r.end = r.p + r.file.size;
+    noteCookedFile(cooked);
+    return true;
+}
+
+// write to a temp file and swap it in, so a crash never leaves half a file.
+// Decode workers can cook the same file at once, so each writer gets its
+// own temp name; the last rename wins with a whole file either way.
+static std::atomic<unsigned int> gCookedWriteCount{ 0 };
+
+static FILE* openCookedForWrite(const std::string& objPath, std::string& tmp) {
+    tmp = cookedPathFor(objPath) + "." + std::to_string(gCookedWriteCount++) + ".tmp";
+    return std::fopen(tmp.c_str(), "wb");
+}
+
+static bool finishCookedWrite(FILE* f, const std::string& objPath,
+    const std::string& tmp) {
+    bool ok = !std::ferror(f);
+    ok = (std::fclose(f) == 0) && ok;
+
+    std::string cooked = cookedPathFor(objPath);
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    std::remove(cooked.c_str());
+    if (std::rename(tmp.c_str(), cooked.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+
+    noteCookedFile(cooked);
+    return true;
+}
+
+std::vector<std::string> cookedFilesUsed() {
+    std::lock_guard<std::mutex> l(gCookedFilesLock);
+    return std::vector<std::string>(gCookedFiles.begin(), gCookedFiles.end());
+}
+
+// ---------- Mesh ----------
+
+bool readCookedMesh(const std::string& objPath, Mesh& out) {
+    CookedReader r;
+    if (!openCookedForRead(objPath, r)) return false;
+
+    Mesh mesh;
+    unsigned char hasBounds = 0;
+    bool ok = readAndValidateHeader(r, COOKED_MESH, 0, objPath) &&
+        readPod(r, mesh.minX) && readPod(r, mesh.maxX) &&
+        readPod(r, mesh.minY) && readPod(r, mesh.maxY) &&
+        readPod(r, mesh.minZ) && readPod(r, mesh.maxZ) &&
+        readPod(r, hasBounds) &&
+        readVertices(r, mesh.vertices) &&
+        readIndices(r, mesh.indices);
+
+    if (!ok) return false;
+
+    mesh.hasBounds = (hasBounds != 0);
+    out = std::move(mesh);
+    return true;
+}
+
+bool writeCookedMesh(const std::string& objPath, const Mesh& mesh) {
+    std::vector<CookedSource> sources(1);
+    if (!describeSource(objPath, sources[0])) return false;
+
+    std::string tmp;
+    FILE* f = openCookedForWrite(objPath, tmp);
+    if (!f) return false;
+
+    writeHeader(f, COOKED_MESH, 0, sources);
+    writePod(f, mesh.minX); writePod(f, mesh.maxX);
+    writePod(f, mesh.minY); writePod(f, mesh.maxY);
+    writePod(f, mesh.minZ); writePod(f, mesh.maxZ);
+    writePod(f, static_cast<unsigned char>(mesh.hasBounds ? 1 : 0));
+    writeVertices(f, mesh.vertices);
+    writeIndices(f, mesh.indices);
+
+    if (!finishCookedWrite(f, objPath, tmp)) return false;
+    gCookedCacheStats.writes++;
+    return true;
+}
+
+// ---------- Model ----------
+
+bool readCookedModel(const std::string& objPath, unsigned int flags,
+    Model& out) {
+    CookedReader r;
+    if (!openCookedForRead(objPath, r)) return false;
+
+    Model model;
+    unsigned int matCount = 0, subCount = 0;
+    bool ok = readAndValidateHeader(r, COOKED_MODEL, flags, objPath) &&
+        readPod(r, matCount) && matCount < 4096;
+
+    for (unsigned int i = 0; ok && i < matCount; ++i) {
+        Material m;
+        ok = readString(r, m.name) && readString(r, m.diffuseMap);
+        model.materials.push_back(m);
+    }
+
+    ok = ok && readPod(r, subCount) && subCount < 4096;
+    for (unsigned int i = 0; ok && i < subCount; ++i) {
+        SubMesh s;
+        ok = readPod(r, s.materialIndex) &&
+            readVertices(r, s.vertices) &&
+            readIndices(r, s.indices);
+        s.computeRadius();
+        model.submeshes.push_back(std::move(s));
+    }
+
+    // LOD levels: one SubMesh per base submesh each, same materials
+    unsigned int lodCount = 0;
+    ok = ok && readPod(r, lodCount) && lodCount < 16;
+    for (unsigned int l = 0; ok && l < lodCount; ++l) {
+        std::vector<SubMesh> level;
+        for (unsigned int i = 0; ok && i < subCount; ++i) {
+            SubMesh s;
+            s.materialIndex = model.submeshes[i].materialIndex;
+            ok = readVertices(r, s.vertices) && readIndices(r, s.indices);
+            s.computeRadius();
+            level.push_back(std::move(s));
+        }
+        model.lods.push_back(std::move(level));
+    }
+
+    if (!ok) return false;
+
+    // GL textures are not cached, only the paths
+    for (auto& m : model.materials) {
+        if (!m.diffuseMap.empty())
+            m.textureId = acquireTexture(m.diffuseMap);
+    }
+
+    out = std::move(model);
+    return true;
+}
+
+bool writeCookedModel(const std::string& objPath,
+    const std::string& mtlPath,
+    unsigned int flags,
+    const Model& model) {
+    std::vector<CookedSource> sources(1);
+    if (!describeSource(objPath, sources[0])) return false;
+    if (!mtlPath.empty()) {
+        CookedSource mtl;
+        if (describeSource(mtlPath, mtl)) sources.push_back(mtl);
+    }
+
+    std::string tmp;
+    FILE* f = openCookedForWrite(objPath, tmp);
+    if (!f) return false;
+
+    writeHeader(f, COOKED_MODEL, flags, sources);
+
+    writePod(f, static_cast<unsigned int>(model.materials.size()));
+    for (const auto& m : model.materials) {
+        writeString(f, m.name);
+        writeString(f, m.diffuseMap);
+    }
+
+    writePod(f, static_cast<unsigned int>(model.submeshes.size()));
+    for (const auto& s : model.submeshes) {
+        writePod(f, s.materialIndex);
+        writeVertices(f, s.vertices);
+        writeIndices(f, s.indices);
+    }
+
+    writePod(f, static_cast<unsigned int>(model.lods.size()));
+    for (const auto& level : model.lods) {
+        for (const auto& s : level) {
+            writeVertices(f, s.vertices);
+            writeIndices(f, s.indices);
+        }
+    }
+
+    if (!finishCookedWrite(f, objPath, tmp)) return false;
+    gCookedCacheStats.writes++;
+    return true;
+}
+
+// ---------- Texture ----------
+
+bool readCookedTexture(const std::string& imagePath, MipChain& out,
+    int maxSize) {
+    CookedReader r;
+    if (!openCookedForRead(imagePath, r)) return false;
+
+    MipChain chain;
+    unsigned int channels = 0, levelCount = 0;
+    bool ok = readAndValidateHeader(r, COOKED_TEXTURE, 0, imagePath) &&
+        readPod(r, channels) && channels >= 1 && channels <= 4 &&
+        readPod(r, levelCount) && levelCount >= 1 && levelCount <= 32;
+
+    chain.channels = static_cast<int>(channels);
+    for (unsigned int i = 0; ok && i < levelCount; ++i) {
+        MipLevel level;
+        unsigned int w = 0, h = 0;
+        ok = readPod(r, w) && readPod(r, h) && w >= 1 && h >= 1 && w <= 16384 && h <= 16384;
+        if (!ok) break;
+
+        unsigned long long bytes = (unsigned long long)w * h * channels;
+        if (bytes > r.left()) { ok = false; break; }   // corrupt
+        if (i == 0) chain.fullSide = static_cast<int>(std::max(w, h));
+
+        // too fine for this request, and not the last level: skip it
+        if (maxSize > 0 && (int)std::max(w, h) > maxSize && i + 1 < levelCount) {
+            ok = r.skip(static_cast<size_t>(bytes));
+            chain.firstLevel++;
+            continue;
+        }
+
+        level.width = static_cast<int>(w);
+        level.height = static_cast<int>(h);
+        level.pixels.resize(static_cast<size_t>(bytes));
+        ok = r.read(level.pixels.data(), level.pixels.size());
+        chain.levels.push_back(std::move(level));
+    }
+
+    if (!ok) return false;
+
+    out = std::move(chain);
+    return true;
+}
+
+bool writeCookedTexture(const std::string& imagePath, const MipChain& chain) {
+    if (chain.levels.empty()) return false;
+
+    std::vector<CookedSource> sources(1);
+    if (!describeSource(imagePath, sources[0])) return false;
+
+    std::string tmp;
+    FILE* f = openCookedForWrite(imagePath, tmp);
+    if (!f) return false;
+
+    writeHeader(f, COOKED_TEXTURE, 0, sources);
+    writePod(f, static_cast<unsigned int>(chain.channels));
+    writePod(f, static_cast<unsigned int>(chain.levels.size()));
+    for (const auto& level : chain.levels) {
+        writePod(f, static_cast<unsigned int>(level.width));
+        writePod(f, static_cast<unsigned int>(level.height));
+        std::fwrite(level.pixels.data(), 1, level.pixels.size(), f);
+    }
+
+    return finishCookedWrite(f, imagePath, tmp);
+}
@@ -0,0 +1,62 @@
+// meshcache.hpp
+#pragma once
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "model.hpp"
+#include "mipmap.hpp"
+
+// Cooked (binary) copies of parsed OBJ files and decoded textures.
+//
+// After the first text parse, loadOBJ / loadOBJWithMTL write
+// "<objPath>.cooked" next to the source. The file starts with a small
+// versioned header that lists every source it was built from (the .obj and,
+// for models, the .mtl) with path, size, mtime and a 64-bit content hash.
+// Later launches read the Mesh / SubMesh arrays straight from it.
+//
+// Readers look in the asset pack first (assetpack.hpp), then map the loose
+// file. A loose cooked file is used only if every listed source still
+// matches: same path and size, and either the same mtime or (if only the
+// mtime moved, e.g. after a git checkout) the same content hash. Packed
+// entries are trusted as they are.
+
+const unsigned int COOKED_MESH_VERSION = 6;   // 6: model LOD levels
+
+struct CookedCacheStats {
+    int hits = 0;     // cooked file was valid and used
+    int misses = 0;   // had to parse the text source
+    int writes = 0;   // cooked files written
+};
+
+extern CookedCacheStats gCookedCacheStats;
+
+// 64-bit FNV-1a over the whole file; returns false if it can't be read.
+bool hashFileContents(const std::string& path, unsigned long long& outHash);
+
+// Returns true and fills `out` if a valid cooked copy of objPath exists.
+bool readCookedMesh(const std::string& objPath, Mesh& out);
+bool writeCookedMesh(const std::string& objPath, const Mesh& mesh);
+
+// Same for models. mtlPath may be empty if the OBJ has no mtllib; flags
+// (LoadFlags) must match the ones the cooked file was written with.
+// Textures are (re)loaded from Material::diffuseMap after reading.
+bool readCookedModel(const std::string& objPath, unsigned int flags,
+    Model& out);
+bool writeCookedModel(const std::string& objPath,
+    const std::string& mtlPath,
+    unsigned int flags,
+    const Model& model);
+
+// Decoded image + full mip chain, "<imagePath>.cooked", ready for
+// glTexImage2D per level. Called from the texture workers, so these don't
+// touch gCookedCacheStats (TextureLoadStats counts them instead).
+// maxSize > 0 reads only the levels no bigger than that (the texture
+// streamer's coarse loads); finer levels are seeked over, not read.
+bool readCookedTexture(const std::string& imagePath, MipChain& out,
+    int maxSize = 0);
+bool writeCookedTexture(const std::string& imagePath, const MipChain& chain);
+
+// Cooked files read from disk or written so far, for packing (assetpack.hpp).
+// Entries served from an open asset pack aren't listed.
+std::vector<std::string> cookedFilesUsed();
@@ -0,0 +1,353 @@
+// meshopt.cpp
+#include "meshopt.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ---------- Analysis ----------
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices,
+    int vertexCount, int cacheSize) {
+    VertexCacheStats stats;
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0 || vertexCount <= 0) return stats;
+
+    // FIFO: a vertex is cached while fewer than cacheSize misses happened
+    // since it was inserted
+    std::vector<unsigned int> insertedAt(vertexCount, 0);
+    unsigned int time = static_cast<unsigned int>(cacheSize) + 1;
+    unsigned int misses = 0;
+
+    for (size_t i = 0; i < triCount * 3; ++i) {
+        unsigned int v = indices[i];
+        if (time - insertedAt[v] > static_cast<unsigned int>(cacheSize)) {
+            insertedAt[v] = time++;
+            ++misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / triCount;
+    stats.atvr = static_cast<float>(misses) / vertexCount;
+    return stats;
+}
+
+// ---------- Vertex cache (Forsyth) ----------
+
+static const int FORSYTH_CACHE_SIZE = 32;
+
+static float forsythVertexScore(int cachePos, int remainingValence) {
+    if (remainingValence == 0) return -1.0f;   // no triangles left to help
+
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) {
+            // just used by the last triangle: fixed score, so the next pick
+            // doesn't simply reuse the same edge forever
+            score = 0.75f;
+        }
+        else {
+            const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePos - 3) * scaler, 1.5f);
+        }
+    }
+
+    // favour vertices with few triangles left, so they get finished off
+    score += 2.0f / std::sqrt(static_cast<float>(remainingValence));
+    return score;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount) {
+    const int triCount = static_cast<int>(indices.size() / 3);
+    if (triCount == 0 || vertexCount <= 0) return;
+
+    // triangles of every vertex (CSR); the first `remaining[v]` entries of
+    // each list are the triangles not emitted yet
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int i = 0; i < triCount * 3; ++i) offsets[indices[i] + 1]++;
+    for (int v = 0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+    std::vector<int> adjacency(triCount * 3);
+    std::vector<int> remaining(vertexCount, 0);
+    for (int t = 0; t < triCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = indices[t * 3 + k];
+            adjacency[offsets[v] + remaining[v]++] = t;
+        }
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (int v = 0; v < vertexCount; ++v)
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+    std::vector<float> triScore(triCount);
+    int best = 0;
+    for (int t = 0; t < triCount; ++t) {
+        triScore[t] = vertexScore[indices[t * 3 + 0]] +
+            vertexScore[indices[t * 3 + 1]] +
+            vertexScore[indices[t * 3 + 2]];
+        if (triScore[t] > triScore[best]) best = t;
+    }
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<unsigned int> out;
+    out.reserve(indices.size());
+
+    int cache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    int scanPos = 0;
+
+    while (best >= 0) {
+        emitted[best] = 1;
+        const unsigned int* tri = &indices[best * 3];
+
+        for (int k = 0; k < 3; ++k) {
+            unsigned int v = tri[k];
+            out.push_back(v);
+
+            // drop this triangle from v's list of pending triangles
+            int* list = &adjacency[offsets[v]];
+            int n = remaining[v];
+            for (int i = 0; i < n; ++i) {
+                if (list[i] == best) {
+                    list[i] = list[n - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+
+        // LRU update: the triangle's vertices move to the front
+        int newCache[FORSYTH_CACHE_SIZE + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            int v = static_cast<int>(tri[k]);
+            bool dup = false;
+            for (int i = 0; i < newCount; ++i) dup = dup || (newCache[i] == v);
+            if (!dup) newCache[newCount++] = v;
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            int v = cache[i];
+            if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+                newCache[newCount++] = v;
+        }
+
+        // everything past the cache size falls out; rescore all touched
+        // vertices and push the score change into their pending triangles
+        for (int i = 0; i < newCount; ++i) {
+            int v = newCache[i];
+            cachePos[v] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+
+            float score = forsythVertexScore(cachePos[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            const int* list = &adjacency[offsets[v]];
+            for (int j = 0; j < remaining[v]; ++j) triScore[list[j]] += delta;
+        }
+
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        for (int i = 0; i < cacheCount; ++i) cache[i] = newCache[i];
+
+        // next triangle: best one touching the cache...
+        best = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; ++i) {
+            int v = cache[i];
+            const int* list = &adjacency[offsets[v]];
+            for (int j = 0; j < remaining[v]; ++j) {
+                if (triScore[list[j]] > bestScore) {
+                    bestScore = triScore[list[j]];
+                    best = list[j];
+                }
+            }
+        }
+
+        // ...or, if the cache has nothing left to offer, the next unused one
+        if (best < 0) {
+            while (scanPos < triCount && emitted[scanPos]) ++scanPos;
+            if (scanPos < triCount) best = scanPos;
+        }
+    }
+
+    indices.swap(out);
+}
+
+// ---------- Overdraw ----------
+
+// vertex cache misses of one triangle, FIFO cache as in analyzeVertexCache
+struct FifoCache {
+    std::vector<unsigned int> insertedAt;
+    unsigned int time;
+    unsigned int size;
+
+    FifoCache(int vertexCount, int cacheSize)
+        : insertedAt(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+    void reset() { time += size + 1; }
+
+    int misses(const unsigned int* tri) {
+        int m = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (time - insertedAt[tri[k]] > size) {
+                insertedAt[tri[k]] = time++;
+                ++m;
+            }
+        }
+        return m;
+    }
+};
+
+void optimizeOverdraw(std::vector<unsigned int>& indices,
+    const std::vector<Vertex>& vertices, float threshold) {
+    const size_t triCount = indices.size() / 3;
+    const int vertexCount = static_cast<int>(vertices.size());
+    if (triCount < 2 || vertexCount == 0) return;
+
+    const int cacheSize = 16;
+    FifoCache cache(vertexCount, cacheSize);
+
+    // 1) hard boundaries: the cache-optimized order restarts (all three
+    //    vertices miss), so cutting there costs nothing
+    std::vector<size_t> hard;
+    for (size_t t = 0; t < triCount; ++t) {
+        if (cache.misses(&indices[t * 3]) == 3) hard.push_back(t);
+    }
+    if (hard.empty() || hard[0] != 0) hard.insert(hard.begin(), 0);
+    hard.push_back(triCount);
+
+    // 2) soft boundaries: inside a hard cluster, cut as soon as the running
+    //    ACMR is within `threshold` of the cluster's own ACMR
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h) {
+        size_t start = hard[h], end = hard[h + 1];
+
+        cache.reset();
+        int clusterMisses = 0;
+        for (size_t t = start; t < end; ++t) clusterMisses += cache.misses(&indices[t * 3]);
+        float limit = threshold * clusterMisses / float(end - start);
+
+        clusters.push_back(start);
+        cache.reset();
+        int runMisses = 0;
+        size_t runStart = start;
+        for (size_t t = start; t < end; ++t) {
+            runMisses += cache.misses(&indices[t * 3]);
+            if (t + 1 < end && runMisses <= limit * float(t + 1 - runStart)) {
+                clusters.push_back(t + 1);
+                cache.reset();
+                runMisses = 0;
+                runStart = t + 1;
+            }
+        }
+    }
+    clusters.push_back(triCount);
+
+    // 3) sort clusters: the ones facing away from the mesh centre (which
+    //    tend to occlude the rest) go first
+    float mc[3] = { 0, 0, 0 };
+    for (const Vertex& v : vertices) {
+        mc[0] += v.px;
+        mc[1] += v.py;
+        mc[2] += v.pz;
+    }
+    for (int c = 0; c < 3; ++c) mc[c] /= vertexCount;
+
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKey(clusterCount);
+    for (size_t ci = 0; ci < clusterCount; ++ci) {
+        float centroid[3] = { 0, 0, 0 };
+        float normal[3] = { 0, 0, 0 };
+        float area = 0.0f;
+
+        for (size_t t = clusters[ci]; t < clusters[ci + 1]; ++t) {
+            // px, py, pz are the first three floats of a Vertex
+            const float* a = &vertices[indices[t * 3 + 0]].px;
+            const float* b = &vertices[indices[t * 3 + 1]].px;
+            const float* c = &vertices[indices[t * 3 + 2]].px;
+
+            float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+            float n[3] = {
+                e1[1] * e2[2] - e1[2] * e2[1],
+                e1[2] * e2[0] - e1[0] * e2[2],
+                e1[0] * e2[1] - e1[1] * e2[0]
+            };
+            float w = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k) {
+                centroid[k] += (a[k] + b[k] + c[k]) * (w / 3.0f);
+                normal[k] += n[k];
+            }
+            area += w;
+        }
+
+        float nl = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (area <= 0.0f || nl <= 0.0f) {
+            sortKey[ci] = -1e30f;   // degenerate: draw last
+            continue;
+        }
+        float key = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            key += (centroid[k] / area - mc[k]) * (normal[k] / nl);
+        sortKey[ci] = key;
+    }
+
+    std::vector<size_t> order(clusterCount);
+    for (size_t i = 0; i < clusterCount; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> out;
+    out.reserve(indices.size());
+    for (size_t ci : order) {
+        out.insert(out.end(),
+            indices.begin() + clusters[ci] * 3,
+            indices.begin() + clusters[ci + 1] * 3);
+    }
+    indices.swap(out);
+}
+
+// ---------- Vertex fetch ----------
+
+void optimizeVertexFetch(std::vector<unsigned int>& indices,
+    std::vector<Vertex>& vertices) {
+    const int vertexCount = static_cast<int>(vertices.size());
+
+    std::vector<unsigned int> oldToNew(vertexCount, ~0u);
+    std::vector<unsigned int> newToOld;
+    newToOld.reserve(vertexCount);
+
+    for (auto& idx : indices) {
+        if (oldToNew[idx] == ~0u) {
+            oldToNew[idx] = static_cast<unsigned int>(newToOld.size());
+            newToOld.push_back(idx);
+        }
+        idx = oldToNew[idx];
+    }
+
+    std::vector<Vertex> out(newToOld.size());
+    for (size_t i = 0; i < newToOld.size(); ++i) out[i] = vertices[newToOld[i]];
+    vertices.swap(out);
+}
+
+void optimizeIndexedMesh(std::vector<unsigned int>& indices,
+    std::vector<Vertex>& vertices,
+    VertexCacheStats* before,
+    VertexCacheStats* after) {
+    const int vertexCount = static_cast<int>(vertices.size());
+    VertexCacheStats original = analyzeVertexCache(indices, vertexCount);
+    if (before) *before = original;
+
+    std::vector<unsigned int> reordered = indices;
+    optimizeVertexCache(reordered, vertexCount);
+    optimizeOverdraw(reordered, vertices);
+
+    // some exports are already in a good order; never make them worse
+    if (analyzeVertexCache(reordered, vertexCount).acmr <= original.acmr)
+        indices.swap(reordered);
+
+    optimizeVertexFetch(indices, vertices);
+
+    if (after) *after = analyzeVertexCache(indices, static_cast<int>(vertices.size()));
+}
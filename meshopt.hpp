@@ -0,0 +1,43 @@
+// meshopt.hpp
+#pragma once
+#include <vector>
+
+#include "vertex.hpp"
+
+// Index / vertex reordering for indexed triangle lists, run once at import
+// time (results end up in the cooked cache).
+//
+//   1) optimizeVertexCache  - Forsyth's linear-speed triangle order for the
+//                             post-transform vertex cache
+//   2) optimizeOverdraw     - Tipsify-style: split that order into clusters
+//                             and draw outward-facing clusters first
+//   3) optimizeVertexFetch  - renumber vertices in first-use order
+//
+// optimizeIndexedMesh runs all three in that order, and keeps the original
+// triangle order if the result would have a worse ACMR.
+
+struct VertexCacheStats {
+    float acmr = 0.0f;   // average cache miss ratio: misses per triangle (0.5 .. 3)
+    float atvr = 0.0f;   // average transform to vertex ratio: misses per vertex (1 = ideal)
+};
+
+// FIFO cache simulation, the usual way ACMR/ATVR are quoted
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices,
+    int vertexCount, int cacheSize = 16);
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, int vertexCount);
+
+// threshold: how much worse than the cache-optimal ACMR a cluster may get
+// before it is split (1.05 = 5%)
+void optimizeOverdraw(std::vector<unsigned int>& indices,
+    const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+// reorders vertices to match the index order; vertices no triangle uses are
+// dropped
+void optimizeVertexFetch(std::vector<unsigned int>& indices,
+    std::vector<Vertex>& vertices);
+
+void optimizeIndexedMesh(std::vector<unsigned int>& indices,
+    std::vector<Vertex>& vertices,
+    VertexCacheStats* before = nullptr,
+    VertexCacheStats* after = nullptr);
@@ -0,0 +1,155 @@
+// mipmap.cpp
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_SSE2 1
+#include <emmintrin.h>
+#else
+#define MIP_SSE2 0
+#endif
+
+size_t MipChain::byteSize() const {
+    size_t total = 0;
+    for (const auto& l : levels) total += l.pixels.size();
+    return total;
+}
+
+int MipChain::largestSide() const {
+    if (levels.empty()) return 0;
+    return std::max(levels[0].width, levels[0].height);
+}
+
+// ---------- Filter passes ----------
+
+// out[i] = r0[i] + r1[i], widened to 16 bits
+static void sumRows(const unsigned char* r0, const unsigned char* r1,
+    unsigned short* out, int n) {
+    int i = 0;
+#if MIP_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + i));
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), hi);
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = static_cast<unsigned short>(r0[i] + r1[i]);
+}
+
+// out pixel x = (sum[2x] + sum[2x+1] + 2) / 4, per channel
+static void sumColumns(const unsigned short* sums, unsigned char* out,
+    int outWidth, int ch) {
+    int x = 0;
+#if MIP_SSE2
+    if (ch == 4) {
+        // 8 source pixels (4 per register pair) -> 4 output pixels
+        const __m128i two = _mm_set1_epi16(2);
+        for (; x + 4 <= outWidth; x += 4) {
+            const unsigned short* s = sums + x * 8;
+            __m128i p01 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            __m128i p23 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 8));
+            __m128i p45 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+            __m128i p67 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 24));
+
+            // even pixels + odd pixels
+            __m128i a = _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+            __m128i b = _mm_add_epi16(_mm_unpacklo_epi64(p45, p67), _mm_unpackhi_epi64(p45, p67));
+            a = _mm_srli_epi16(_mm_add_epi16(a, two), 2);
+            b = _mm_srli_epi16(_mm_add_epi16(b, two), 2);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(a, b));
+        }
+    }
+#endif
+    for (; x < outWidth; ++x) {
+        const unsigned short* s = sums + x * 2 * ch;
+        for (int c = 0; c < ch; ++c)
+            out[x * ch + c] = static_cast<unsigned char>((s[c] + s[ch + c] + 2) >> 2);
+    }
+}
+
+// a 1-pixel-wide or 1-pixel-tall level only has one axis to filter
+static void downsampleThin(const MipLevel& src, MipLevel& dst, int ch) {
+    for (int y = 0; y < dst.height; ++y) {
+        int y0 = std::min(2 * y, src.height - 1);
+        int y1 = std::min(2 * y + 1, src.height - 1);
+        for (int x = 0; x < dst.width; ++x) {
+            int x0 = std::min(2 * x, src.width - 1);
+            int x1 = std::min(2 * x + 1, src.width - 1);
+            const unsigned char* a = &src.pixels[(y0 * src.width + x0) * ch];
+            const unsigned char* b = &src.pixels[(y0 * src.width + x1) * ch];
+            const unsigned char* c = &src.pixels[(y1 * src.width + x0) * ch];
+            const unsigned char* d = &src.pixels[(y1 * src.width + x1) * ch];
+            unsigned char* o = &dst.pixels[(y * dst.width + x) * ch];
+            for (int k = 0; k < ch; ++k)
+                o[k] = static_cast<unsigned char>((a[k] + b[k] + c[k] + d[k] + 2) >> 2);
+        }
+    }
+}
+
+static void downsample(const MipLevel& src, MipLevel& dst, int ch) {
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * ch);
+
+    if (src.width < 2 || src.height < 2) {
+        downsampleThin(src, dst, ch);
+        return;
+    }
+
+    size_t srcStride = static_cast<size_t>(src.width) * ch;
+    size_t dstStride = static_cast<size_t>(dst.width) * ch;
+    int rowBytes = dst.width * 2 * ch;   // drops an odd last column
+    std::vector<unsigned short> sums(rowBytes);
+
+    for (int y = 0; y < dst.height; ++y) {
+        const unsigned char* r0 = &src.pixels[(2 * y) * srcStride];
+        const unsigned char* r1 = r0 + srcStride;
+        sumRows(r0, r1, sums.data(), rowBytes);
+        sumColumns(sums.data(), &dst.pixels[y * dstStride], dst.width, ch);
+    }
+}
+
+// ---------- Chain ----------
+
+void buildMipChain(const unsigned char* pixels, int width, int height,
+    int channels, MipChain& out) {
+    out.channels = channels;
+    out.firstLevel = 0;
+    out.fullSide = 0;
+    out.levels.clear();
+    if (!pixels || width <= 0 || height <= 0) return;
+
+    out.fullSide = std::max(width, height);
+
+    MipLevel base;
+    base.width = width;
+    base.height = height;
+    base.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+    out.levels.push_back(std::move(base));
+
+    while (out.levels.back().width > 1 || out.levels.back().height > 1) {
+        MipLevel next;
+        downsample(out.levels.back(), next, channels);
+        out.levels.push_back(std::move(next));
+    }
+}
+
+void dropFinestLevels(MipChain& chain, int maxSize) {
+    if (maxSize <= 0) return;
+
+    size_t drop = 0;
+    while (drop + 1 < chain.levels.size() &&
+        std::max(chain.levels[drop].width, chain.levels[drop].height) > maxSize)
+        ++drop;
+
+    chain.levels.erase(chain.levels.begin(), chain.levels.begin() + drop);
+    chain.firstLevel += static_cast<int>(drop);
+}
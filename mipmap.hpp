@@ -0,0 +1,36 @@
+// mipmap.hpp
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Full mip chains built on the CPU at import time, so the GL 1.1 path can
+// upload every level itself (no glGenerateMipmap / GL_GENERATE_MIPMAP).
+//
+// Each level is a 2x2 box filter of the one above it (the same filter
+// gluBuild2DMipmaps uses). Sizes halve with floor down to 1x1; an odd last
+// row / column is dropped, as GL expects. The row sums run with SSE2 where
+// available, and the column pass for RGBA images too.
+
+struct MipLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;   // width * height * channels, tightly packed
+};
+
+struct MipChain {
+    int channels = 0;                    // 1..4, same as stb_image
+    int firstLevel = 0;                  // which level of the full image levels[0] is
+    int fullSide = 0;                    // largest side of the full image, kept when levels drop
+    std::vector<MipLevel> levels;        // [0] = full size (or firstLevel) ... 1x1
+
+    int largestSide() const;             // of levels[0], 0 if empty
+
+    size_t byteSize() const;
+};
+
+void buildMipChain(const unsigned char* pixels, int width, int height,
+    int channels, MipChain& out);
+
+// drops levels bigger than maxSize on either side (0 = keep all); the 1x1
+// level always stays
+void dropFinestLevels(MipChain& chain, int maxSize);
@@ -1,13 +1,18 @@
-#include "Model.hpp"
+#include "model.hpp"
+#include "meshcache.hpp"
+#include "meshopt.hpp"
+#include "objparse.hpp"
+#include "renderqueue.hpp"
+#include "simplify.hpp"
 
 #include <glut.h>
+#include "glcalls.hpp"
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <sstream>
+#include <cmath>
 #include <iostream>
-#include <algorithm>
-
-struct Vec3 { float x, y, z; };
-struct Vec2 { float u, v; };
 
 // ---------- Helpers ----------
 
@@ -97,7 +102,8 @@ static void loadMTL(const std::string& mtlPath,
             }
 
             current->diffuseMap = joinPath(baseDir, texFile);
-            current->textureId = loadTexture(current->diffuseMap.c_str());
+            releaseTexture(current->textureId);   // map_Kd given twice
+            current->textureId = acquireTexture(current->diffuseMap);
 
             std::cout << "Material " << current->name
                 << " map_Kd -> " << current->diffuseMap
@@ -111,185 +117,174 @@ static void loadMTL(const std::string& mtlPath,
 
 
 
-// ---------- OBJ + MTL loader ----------
+// ---------- LOD generation ----------
 
-Model loadOBJWithMTL(const std::string& objPath,
-    const std::string& baseDir) {
-    Model model;
+// each level aims for this share of LOD 0's triangles, within an error of
+// LOD_ERROR * the model's radius
+static const int LOD_LEVELS = 3;
+static const float LOD_RATIO[LOD_LEVELS] = { 0.5f, 0.25f, 0.125f };
+static const float LOD_ERROR[LOD_LEVELS] = { 0.01f, 0.02f, 0.04f };
 
-    std::ifstream in(objPath);
-    if (!in) {
-        std::cerr << "Could not open OBJ file: " << objPath << "\n";
-        return model;
-    }
+static int countTriangles(const std::vector<SubMesh>& subs) {
+    int n = 0;
+    for (const auto& s : subs) n += s.triangleCount();
+    return n;
+}
 
-    std::string line;
-    std::string mtlFileName;
+// Each level is simplified from the one before, then compacted to the
+// vertices it still uses and reordered for the vertex cache. A level that
+// gets less than 10% below the previous one (everything left is border or
+// seam) ends the chain.
+static void buildLods(Model& model) {
+    float radius = model.boundingRadius();
+    int baseTriangles = countTriangles(model.submeshes);
+    const std::vector<SubMesh>* prev = &model.submeshes;
+
+    for (int level = 0; level < LOD_LEVELS; ++level) {
+        std::vector<SubMesh> subs;
+        float worstError = 0.0f;
+
+        for (size_t i = 0; i < prev->size(); ++i) {
+            const SubMesh& from = (*prev)[i];
+            const SubMesh& base = model.submeshes[i];
+
+            size_t target = static_cast<size_t>(base.triangleCount() * LOD_RATIO[level]) * 3;
+            float error = 0.0f;
+            std::vector<unsigned int> indices = simplifyMesh(from.indices.toVector(),
+                from.vertices, target, radius * LOD_ERROR[level], &error);
+            worstError = std::max(worstError, error);
+
+            SubMesh s;
+            s.materialIndex = from.materialIndex;
+            s.vertices = from.vertices;
+            optimizeVertexCache(indices, s.vertexCount());
+            optimizeVertexFetch(indices, s.vertices);
+            s.indices.assign(indices, s.vertexCount());
+            s.computeRadius();
+            subs.push_back(std::move(s));
+        }
 
-    std::vector<Vec3> tempV;
-    std::vector<Vec3> tempVN;
-    std::vector<Vec2> tempVT;
+        int before = countTriangles(*prev), after = countTriangles(subs);
+        if (after > before * 0.9f) break;
 
-    int currentMaterial = -1;
-    int currentSubMesh = -1;
+        std::cout << "  LOD " << level + 1 << ": " << after << " triangles ("
+            << std::lround(100.0f * after / std::max(baseTriangles, 1)) << "% of LOD 0), error "
+            << std::setprecision(3) << worstError << std::setprecision(6) << "\n";
+        model.lods.push_back(std::move(subs));
+        prev = &model.lods.back();
+    }
+}
 
-    while (std::getline(in, line)) {
-        if (line.empty() || line[0] == '#') continue;
+// ---------- OBJ + MTL loader ----------
 
-        std::istringstream iss(line);
-        std::string cmd;
-        iss >> cmd;
+Model loadOBJWithMTL(const std::string& objPath,
+    const std::string& baseDir,
+    unsigned int flags) {
+    Model model;
 
-        if (cmd == "mtllib") {
-            // read the rest of the line as one string (can contain spaces)
-            std::string rest;
-            std::getline(iss, rest);
+    if (readCookedModel(objPath, flags, model)) {
+        gCookedCacheStats.hits++;
+        std::cout << "Loaded model from cooked cache " << objPath
+            << " with " << model.submeshes.size()
+            << " submeshes and " << model.materials.size()
+            << " materials.\n";
+        model.uploadToGPU();
+        return model;
+    }
+    gCookedCacheStats.misses++;
 
-            // trim leading spaces
-            size_t start = rest.find_first_not_of(" \t\r\n");
-            if (start != std::string::npos)
-                rest = rest.substr(start);
+    ObjData obj;
+    if (!parseOBJFile(objPath, obj)) {
+        std::cerr << "Could not open OBJ file: " << objPath << "\n";
+        return model;
+    }
 
-            mtlFileName = rest;  // e.g. "Army man.mtl"
-        }
-        else if (cmd == "usemtl") {
-            std::string matName;
-            iss >> matName;
+    // which usemtl groups end up in which submesh
+    std::vector<std::vector<int>> groupsOfSubMesh;
+
+    for (size_t g = 0; g < obj.groups.size(); ++g) {
+        int currentMaterial = -1;   // faces before any usemtl
+        const std::string& matName = obj.groups[g].material;
 
+        if (!matName.empty()) {
             // make sure the material exists in model.materials
-            int matIndex = findMaterialIndex(model.materials, matName);
-            if (matIndex == -1) {
+            currentMaterial = findMaterialIndex(model.materials, matName);
+            if (currentMaterial == -1) {
                 // create placeholder; will be filled when we parse MTL
                 Material m;
                 m.name = matName;
                 model.materials.push_back(m);
-                matIndex = static_cast<int>(model.materials.size() - 1);
+                currentMaterial = static_cast<int>(model.materials.size() - 1);
             }
-
-            currentMaterial = matIndex;
-            currentSubMesh = findOrCreateSubMesh(model.submeshes,
-                currentMaterial);
-        }
-        else if (cmd == "v") {
-            Vec3 v;
-            iss >> v.x >> v.y >> v.z;
-            tempV.push_back(v);
-        }
-        else if (cmd == "vn") {
-            Vec3 n;
-            iss >> n.x >> n.y >> n.z;
-            tempVN.push_back(n);
-        }
-        else if (cmd == "vt") {
-            Vec2 t;
-            iss >> t.u >> t.v;
-            tempVT.push_back(t);
         }
-        else if (cmd == "f") {
-            if (currentSubMesh == -1) {
-                // no material yet, create one "default"
-                currentMaterial = -1;
-                currentSubMesh = findOrCreateSubMesh(model.submeshes,
-                    currentMaterial);
-            }
 
-            SubMesh& s = model.submeshes[currentSubMesh];
-
-            // we support: v/vt/vn, v/vt, v//vn, v
-            std::vector<std::string> tokens;
-            std::string tok;
-            while (iss >> tok) tokens.push_back(tok);
-            if (tokens.size() < 3) continue;
-
-            auto parseVertex = [&](const std::string& str,
-                int& outV, int& outVT, int& outVN) {
-                    outV = outVT = outVN = 0;
-
-                    if (str.find("//") != std::string::npos) {
-                        std::sscanf(str.c_str(), "%d//%d", &outV, &outVN);
-                    }
-                    else {
-                        int slashCount =
-                            static_cast<int>(std::count(str.begin(),
-                                str.end(), '/'));
-                        if (slashCount == 0) {
-                            std::sscanf(str.c_str(), "%d", &outV);
-                        }
-                        else if (slashCount == 1) {
-                            std::sscanf(str.c_str(), "%d/%d", &outV, &outVT);
-                        }
-                        else {
-                            std::sscanf(str.c_str(), "%d/%d/%d",
-                                &outV, &outVT, &outVN);
-                        }
-                    }
-                };
-
-            // triangulate as fan: (0, i, i+1)
-            for (size_t i = 1; i + 1 < tokens.size(); ++i) {
-                int idx[3] = { 0, (int)i, (int)i + 1 };
-
-                for (int k = 0; k < 3; ++k) {
-                    int vIdx, vtIdx, vnIdx;
-                    parseVertex(tokens[idx[k]], vIdx, vtIdx, vnIdx);
-
-                    int vi = vIdx - 1;
-                    int ti = vtIdx - 1;
-                    int ni = vnIdx - 1;
-
-                    // position
-                    const Vec3& v = tempV[vi];
-                    s.vertices.push_back(v.x);
-                    s.vertices.push_back(v.y);
-                    s.vertices.push_back(v.z);
-
-                    // normal
-                    if (!tempVN.empty() && ni >= 0 &&
-                        ni < (int)tempVN.size()) {
-                        const Vec3& n = tempVN[ni];
-                        s.normals.push_back(n.x);
-                        s.normals.push_back(n.y);
-                        s.normals.push_back(n.z);
-                    }
-                    else {
-                        s.normals.push_back(0.0f);
-                        s.normals.push_back(1.0f);
-                        s.normals.push_back(0.0f);
-                    }
-
-                    // texcoord
-                    if (!tempVT.empty() && ti >= 0 &&
-                        ti < (int)tempVT.size()) {
-                        const Vec2& t = tempVT[ti];
-                        s.texcoords.push_back(t.u);
-                        s.texcoords.push_back(t.v);
-                    }
-                    else {
-                        s.texcoords.push_back(0.0f);
-                        s.texcoords.push_back(0.0f);
-                    }
-                }
-            }
+        int currentSubMesh = findOrCreateSubMesh(model.submeshes,
+            currentMaterial);
+        groupsOfSubMesh.resize(model.submeshes.size());
+        groupsOfSubMesh[currentSubMesh].push_back(static_cast<int>(g));
+    }
+
+    size_t expandedBytes = 0, indexedBytes = 0;
+    for (size_t i = 0; i < model.submeshes.size(); ++i) {
+        SubMesh& s = model.submeshes[i];
+
+        std::vector<unsigned int> indices;
+        indexCorners(obj, groupsOfSubMesh[i], s.vertices, indices);
+
+        if (flags & LOAD_OPTIMIZE) {
+            VertexCacheStats before, after;
+            optimizeIndexedMesh(indices, s.vertices, &before, &after);
+            std::cout << "  submesh " << i << std::fixed << std::setprecision(3)
+                << ": ACMR " << before.acmr << " -> " << after.acmr
+                << ", ATVR " << before.atvr << " -> " << after.atvr
+                << std::defaultfloat << std::setprecision(6) << "\n";
         }
+        s.indices.assign(indices, s.vertexCount());
+        s.computeRadius();
+
+        expandedBytes += indices.size() * sizeof(Vertex);
+        indexedBytes += s.vertexCount() * sizeof(Vertex) + s.indices.byteSize();
     }
 
+    if (flags & LOAD_LODS) buildLods(model);
+
     // now load the .mtl (if present) and hook textures
-    if (!mtlFileName.empty()) {
-        std::string mtlPath = joinPath(baseDir, mtlFileName);
+    std::string mtlPath;
+    if (!obj.mtllib.empty()) {
+        mtlPath = joinPath(baseDir, obj.mtllib);   // e.g. "Army man.mtl"
         loadMTL(mtlPath, baseDir, model.materials);
     }
 
+    if (!writeCookedModel(objPath, mtlPath, flags, model))
+        std::cerr << "Could not write cooked model for " << objPath << "\n";
+
 
     std::cout << "Loaded model from " << objPath
         << " with " << model.submeshes.size()
         << " submeshes and " << model.materials.size()
-        << " materials.\n";
+        << " materials ("
+        << indexedBytes / 1024 << " KB indexed vs "
+        << expandedBytes / 1024 << " KB expanded).\n";
 
+    model.uploadToGPU();
     return model;
 }
 
 // ---------- draw ----------
 
+void SubMesh::computeRadius() {
+    float r2 = 0.0f;
+    for (const Vertex& v : vertices) {
+        float d2 = v.px * v.px + v.py * v.py + v.pz * v.pz;
+        if (d2 > r2) r2 = d2;
+    }
+    radius = std::sqrt(r2);
+}
+
+void SubMesh::uploadToGPU() {
+    gpu.upload(vertices, indices);
+}
+
 void SubMesh::draw(const std::vector<Material>& materials) const {
     int matIndex = materialIndex;
     unsigned int texId = 0;
@@ -308,30 +303,79 @@ void SubMesh::draw(const std::vector<Material>& materials) const {
         glColor3f(0.7f, 0.7f, 0.7f);
     }
 
-    glBegin(GL_TRIANGLES);
-    int nVerts = vertexCount();
-    for (int i = 0; i < nVerts; ++i) {
-        if (!normals.empty()) {
-            glNormal3f(normals[3 * i + 0],
-                normals[3 * i + 1],
-                normals[3 * i + 2]);
-        }
-        if (!texcoords.empty()) {
-            glTexCoord2f(texcoords[2 * i + 0],
-                texcoords[2 * i + 1]);
-        }
-        glVertex3f(vertices[3 * i + 0],
-            vertices[3 * i + 1],
-            vertices[3 * i + 2]);
-    }
-    glEnd();
+    drawGeometry();
 
     if (texId)
         glDisable(GL_TEXTURE_2D);
 }
 
+void SubMesh::drawGeometry() const {
+    drawIndexedGeometry(vertices, indices, gpu, list, true);
+}
+
+const std::vector<SubMesh>& Model::level(int lod) const {
+    if (lod <= 0 || lods.empty()) return submeshes;
+    return lods[std::min(lod, static_cast<int>(lods.size())) - 1];
+}
+
+void Model::uploadToGPU() {
+    for (auto& s : submeshes) s.uploadToGPU();
+    for (auto& level : lods)
+        for (auto& s : level) s.uploadToGPU();
+}
+
 void Model::draw() const {
     for (const auto& s : submeshes) {
         s.draw(materials);
     }
 }
+
+float Model::boundingRadius() const {
+    float r = 0.0f;
+    for (const auto& s : submeshes) r = std::max(r, s.radius);
+    return r;
+}
+
+void Model::release(RenderQueue* queue) {
+    for (auto& m : materials) {
+        releaseTexture(m.textureId);
+        m.textureId = 0;
+    }
+    for (auto& s : submeshes) {
+        if (queue) queue->forget(&s);
+        s.gpu.release();
+        s.list.release();
+    }
+    for (auto& level : lods) {
+        for (auto& s : level) {
+            if (queue) queue->forget(&s);
+            s.gpu.release();
+            s.list.release();
+        }
+    }
+    materials.clear();
+    submeshes.clear();
+    lods.clear();
+}
+
+// ---------- LOD selection ----------
+
+bool gUseLod = true;
+
+// screen size below which LOD k + 1 is used, and how far past it (as a
+// fraction) the size has to move before switching
+static const float LOD_SWITCH[LOD_LEVELS] = { 0.35f, 0.18f, 0.09f };
+static const float LOD_HYSTERESIS = 0.15f;
+
+int selectLod(float screenSize, int current, int lodCount) {
+    if (!gUseLod) return 0;
+
+    int lod = 0;
+    for (int k = 0; k < LOD_LEVELS && k + 1 < lodCount; ++k) {
+        // coarser than this switch point already: it must grow past it
+        // by the margin to come back, and the other way round
+        float margin = current > k ? 1.0f + LOD_HYSTERESIS : 1.0f - LOD_HYSTERESIS;
+        if (screenSize < LOD_SWITCH[k] * margin) lod = k + 1;
+    }
+    return lod;
+}
@@ -2,10 +2,10 @@
 #include <vector>
 #include <string>
 
-// Forward declaration: you already have this in main.cpp
-// (stb_image + OpenGL texture creation).
-// We will call it from the loader.
-unsigned int loadTexture(const char* filename);
+#include "mesh.hpp"      // IndexBuffer
+#include "texture.hpp"   // acquireTexture / releaseTexture
+
+struct RenderQueue;
 
 // ---------- Materials ----------
 
@@ -18,16 +18,26 @@ struct Material {
 // ---------- Sub-mesh (a set of triangles using one material) ----------
 
 struct SubMesh {
-    std::vector<float> vertices;   // x,y,z
-    std::vector<float> normals;    // nx,ny,nz
-    std::vector<float> texcoords;  // u,v
+    std::vector<Vertex> vertices;  // unique vertices
+    IndexBuffer indices;           // triangle list into the arrays above
     int materialIndex = -1;        // index into Model::materials
+    float radius = 0.0f;           // bounding sphere around the model origin
+    VertexBuffers gpu;             // filled by uploadToGPU, if buffers are available
+    DisplayList list;              // RENDER_DISPLAY_LIST
 
     int vertexCount() const {
-        return static_cast<int>(vertices.size() / 3);
+        return static_cast<int>(vertices.size());
+    }
+    int triangleCount() const {
+        return indices.size() / 3;
     }
 
+    void computeRadius();
+    void uploadToGPU();
+    // straight to GL; only draws through RenderQueue report texture use
+    // for streaming
     void draw(const std::vector<Material>& materials) const;
+    void drawGeometry() const;     // no material / texture state
 };
 
 // ---------- Whole model (OBJ with materials) ----------
@@ -36,11 +46,50 @@ struct Model {
     std::vector<Material> materials;
     std::vector<SubMesh>  submeshes;
 
+    // Coarser copies built with LOAD_LODS (simplify.hpp): lods[k] is LOD
+    // k + 1, one SubMesh per entry of submeshes, same materials.
+    std::vector<std::vector<SubMesh>> lods;
+
+    int lodCount() const { return 1 + static_cast<int>(lods.size()); }
+
+    // submeshes for LOD 0, lods[lod - 1] otherwise (clamped)
+    const std::vector<SubMesh>& level(int lod) const;
+
+    void uploadToGPU();
     void draw() const;
+
+    // largest SubMesh::radius: a sphere around the origin holding the model
+    float boundingRadius() const;
+
+    // drops this model's texture references (textures nothing else uses are
+    // deleted), frees its vertex buffers and clears it; Model is copied
+    // around by value, so this is explicit rather than a destructor.
+    // Pass the queue it was drawn through so it forgets the submeshes too.
+    void release(RenderQueue* queue = nullptr);
+};
+
+// ---------- LOD selection ----------
+
+// false = always draw LOD 0 (--no-lod)
+extern bool gUseLod;
+
+// LOD for a model whose bounding sphere spans `screenSize` of the viewport's
+// half height. Each switch point must be passed by a margin before the
+// level changes, so an object near one doesn't flicker between two levels;
+// `current` is the level it was drawn at last.
+int selectLod(float screenSize, int current, int lodCount);
+
+// Import options; part of the cooked-cache key
+enum LoadFlags {
+    LOAD_DEFAULT = 0,
+    LOAD_OPTIMIZE = 1 << 0,  // vertex cache / overdraw / fetch reordering (meshopt)
+    LOAD_LODS = 1 << 1       // build Model::lods by simplification
 };
 
 // Loads .obj and its .mtl, given:
 //   objPath: full path to Soldier.obj
 //   baseDir: directory where textures & mtl live (for resolving paths)
+//   flags:   LoadFlags
 Model loadOBJWithMTL(const std::string& objPath,
-    const std::string& baseDir);
+    const std::string& baseDir,
+    unsigned int flags = LOAD_DEFAULT);
@@ -0,0 +1,617 @@
+// objparse.cpp
+#include "objparse.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---------- MappedFile ----------
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    fileHandle = file;
+
+    LARGE_INTEGER len;
+    if (!GetFileSizeEx(file, &len)) {
+        close();
+        return false;
+    }
+    if (len.QuadPart == 0) return true;   // empty files can't be mapped
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    mapHandle = mapping;
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        close();
+        return false;
+    }
+    size = static_cast<size_t>(len.QuadPart);
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {   // empty files can't be mapped
+        ::close(fd);
+        return true;
+    }
+
+    void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // the mapping keeps its own reference
+    if (p == MAP_FAILED) return false;
+
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(p);
+    size = static_cast<size_t>(st.st_size);
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mapHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+// ---------- Number scanning ----------
+// Both scanners advance p only on success and never read at or past end.
+
+static inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) ++p;
+    return p;
+}
+
+// exact powers of ten representable in a double
+static const double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// [+-]digits[.digits][(e|E)[+-]digits], leading blanks skipped
+static bool scanFloat(const char*& p, const char* end, float& out) {
+    const char* s = skipBlanks(p, end);
+
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        neg = (*s == '-');
+        ++s;
+    }
+
+    // up to 19 significant digits fit in the mantissa, the rest only scale
+    unsigned long long mant = 0;
+    int sigDigits = 0;
+    int exp10 = 0;
+    bool anyDigit = false;
+
+    while (s < end && isDigit(*s)) {
+        if (sigDigits < 19) {
+            mant = mant * 10 + (*s - '0');
+            if (mant) ++sigDigits;
+        }
+        else {
+            ++exp10;
+        }
+        anyDigit = true;
+        ++s;
+    }
+    if (s < end && *s == '.') {
+        ++s;
+        while (s < end && isDigit(*s)) {
+            if (sigDigits < 19) {
+                mant = mant * 10 + (*s - '0');
+                if (mant) ++sigDigits;
+                --exp10;
+            }
+            anyDigit = true;
+            ++s;
+        }
+    }
+    if (!anyDigit) return false;
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool expNeg = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            expNeg = (*e == '-');
+            ++e;
+        }
+        if (e < end && isDigit(*e)) {
+            int ev = 0;
+            while (e < end && isDigit(*e)) {
+                if (ev < 10000) ev = ev * 10 + (*e - '0');
+                ++e;
+            }
+            exp10 += expNeg ? -ev : ev;
+            s = e;
+        }
+    }
+
+    double v = static_cast<double>(mant);
+    if (mant != 0) {
+        // one multiply/divide by an exact power keeps the common case exact
+        while (exp10 > 22) { v *= 1e22; exp10 -= 22; }
+        while (exp10 < -22) { v /= 1e22; exp10 += 22; }
+        if (exp10 > 0) v *= POW10[exp10];
+        else if (exp10 < 0) v /= POW10[-exp10];
+    }
+
+    out = static_cast<float>(neg ? -v : v);
+    p = s;
+    return true;
+}
+
+// [+-]digits, no blank skipping (used inside face tokens)
+static bool scanInt(const char*& p, const char* end, int& out) {
+    const char* s = p;
+    bool neg = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        neg = (*s == '-');
+        ++s;
+    }
+    if (s >= end || !isDigit(*s)) return false;
+
+    int v = 0;
+    while (s < end && isDigit(*s)) {
+        v = v * 10 + (*s - '0');
+        ++s;
+    }
+
+    out = neg ? -v : v;
+    p = s;
+    return true;
+}
+
+// 1-based or negative (relative to the current count) -> 0-based, -1 if absent
+static inline int resolveIndex(int idx, size_t count) {
+    if (idx > 0) return idx - 1;
+    if (idx < 0) return static_cast<int>(count) + idx;
+    return -1;
+}
+
+static inline bool cmdIs(const char* cmd, size_t len, const char* name) {
+    return std::strlen(name) == len && std::memcmp(cmd, name, len) == 0;
+}
+
+// ---------- Parser ----------
+
+// Extra bookkeeping when a range is parsed as one chunk of a bigger file.
+// Positive OBJ indices are already global; only the relative (negative) ones
+// and the usemtl state at the start of the chunk depend on earlier chunks.
+struct ObjChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    ObjData data;
+
+    // groups[0] holds faces that came before the chunk's first usemtl,
+    // i.e. they continue whatever material the previous chunk ended with
+    bool leadingFaces = false;
+
+    // corners whose indices were relative and are still chunk-local
+    struct RelativeFix {
+        size_t corner;
+        unsigned char mask;   // REL_V | REL_VT | REL_VN
+    };
+    std::vector<RelativeFix> relativeFixes;
+
+    // exclusive prefix sums over the previous chunks
+    size_t basePosition = 0;
+    size_t baseNormal = 0;
+    size_t baseTexcoord = 0;
+    size_t baseCorner = 0;
+};
+
+enum {
+    REL_V = 1,
+    REL_VT = 2,
+    REL_VN = 4
+};
+
+struct PendingCorner {
+    ObjCorner c;
+    unsigned char relative;   // REL_* bits
+};
+
+// chunk == nullptr: [begin, end) is the whole file
+static void parseRange(const char* begin, const char* end,
+    ObjData& out, ObjChunk* chunk) {
+    const char* p = begin;
+
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* lineEnd = nl ? nl : end;
+        const char* next = nl ? nl + 1 : end;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+
+        p = skipBlanks(p, lineEnd);
+        if (p >= lineEnd || *p == '#') {
+            p = next;
+            continue;
+        }
+
+        const char* cmd = p;
+        while (p < lineEnd && !isBlank(*p)) ++p;
+        size_t cmdLen = static_cast<size_t>(p - cmd);
+
+        if (cmdIs(cmd, cmdLen, "v")) {
+            ObjFloat3 v = { 0.0f, 0.0f, 0.0f };
+            scanFloat(p, lineEnd, v.x);
+            scanFloat(p, lineEnd, v.y);
+            scanFloat(p, lineEnd, v.z);
+            out.positions.push_back(v);
+        }
+        else if (cmdIs(cmd, cmdLen, "vn")) {
+            ObjFloat3 n = { 0.0f, 0.0f, 0.0f };
+            scanFloat(p, lineEnd, n.x);
+            scanFloat(p, lineEnd, n.y);
+            scanFloat(p, lineEnd, n.z);
+            out.normals.push_back(n);
+        }
+        else if (cmdIs(cmd, cmdLen, "vt")) {
+            ObjFloat2 t = { 0.0f, 0.0f };
+            scanFloat(p, lineEnd, t.u);
+            scanFloat(p, lineEnd, t.v);
+            out.texcoords.push_back(t);
+        }
+        else if (cmdIs(cmd, cmdLen, "f")) {
+            // triangulate as fan: (0, i, i+1)
+            PendingCorner first = { { -1, -1, -1 }, 0 };
+            PendingCorner prev = { { -1, -1, -1 }, 0 };
+            int n = 0;
+            size_t added = 0;
+
+            for (;;) {
+                p = skipBlanks(p, lineEnd);
+                int raw = 0;
+                if (!scanInt(p, lineEnd, raw)) break;
+
+                PendingCorner pc;
+                pc.c.v = resolveIndex(raw, out.positions.size());
+                pc.c.vt = -1;
+                pc.c.vn = -1;
+                pc.relative = (raw < 0) ? REL_V : 0;
+
+                if (p < lineEnd && *p == '/') {
+                    ++p;
+                    if (scanInt(p, lineEnd, raw)) {                 // v/vt
+                        pc.c.vt = resolveIndex(raw, out.texcoords.size());
+                        if (raw < 0) pc.relative |= REL_VT;
+                    }
+                    if (p < lineEnd && *p == '/') {                 // v/vt/vn, v//vn
+                        ++p;
+                        if (scanInt(p, lineEnd, raw)) {
+                            pc.c.vn = resolveIndex(raw, out.normals.size());
+                            if (raw < 0) pc.relative |= REL_VN;
+                        }
+                    }
+                }
+                while (p < lineEnd && !isBlank(*p)) ++p;
+
+                if (n == 0) {
+                    first = pc;
+                }
+                else if (n >= 2) {
+                    const PendingCorner* tri[3] = { &first, &prev, &pc };
+                    for (int k = 0; k < 3; ++k) {
+                        if (chunk && tri[k]->relative) {
+                            ObjChunk::RelativeFix fix = { out.corners.size(), tri[k]->relative };
+                            chunk->relativeFixes.push_back(fix);
+                        }
+                        out.corners.push_back(tri[k]->c);
+                    }
+                    added += 3;
+                }
+                prev = pc;
+                ++n;
+            }
+
+            if (added) {
+                if (out.groups.empty()) {
+                    // faces before any usemtl (in this chunk)
+                    out.groups.push_back(ObjGroup());
+                    out.groups.back().firstCorner = out.corners.size() - added;
+                    if (chunk) chunk->leadingFaces = true;
+                }
+                out.groups.back().cornerCount += added;
+            }
+        }
+        else if (cmdIs(cmd, cmdLen, "usemtl")) {
+            p = skipBlanks(p, lineEnd);
+            const char* name = p;
+            while (p < lineEnd && !isBlank(*p)) ++p;
+
+            ObjGroup g;
+            g.material.assign(name, p);
+            g.firstCorner = out.corners.size();
+            out.groups.push_back(g);
+        }
+        else if (cmdIs(cmd, cmdLen, "mtllib")) {
+            // rest of the line, can contain spaces ("Army man.mtl")
+            p = skipBlanks(p, lineEnd);
+            const char* last = lineEnd;
+            while (last > p && isBlank(last[-1])) --last;
+            out.mtllib.assign(p, last);
+        }
+
+        p = next;
+    }
+}
+
+void parseOBJ(const char* begin, const char* end, ObjData& out) {
+    parseRange(begin, end, out, nullptr);
+}
+
+// ---------- Threaded parse ----------
+
+int gObjParseThreads = 0;
+
+static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+static const int MAX_PARSE_THREADS = 8;
+
+// runs fn(chunk) for every chunk, the first one on the calling thread
+template <typename Fn>
+static void forEachChunk(std::vector<ObjChunk>& chunks, Fn fn) {
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size());
+    for (size_t i = 1; i < chunks.size(); ++i)
+        workers.emplace_back(fn, std::ref(chunks[i]));
+    fn(chunks[0]);
+    for (auto& t : workers) t.join();
+}
+
+int objParseThreadCount(size_t bytes) {
+    int threads = gObjParseThreads;
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads > MAX_PARSE_THREADS) threads = MAX_PARSE_THREADS;
+        // not worth a thread per tiny chunk
+        size_t maxByBytes = bytes / MIN_CHUNK_BYTES;
+        if ((size_t)threads > maxByBytes) threads = static_cast<int>(maxByBytes);
+    }
+    return threads < 1 ? 1 : threads;
+}
+
+void parseOBJParallel(const char* begin, const char* end, ObjData& out,
+    int threads) {
+    size_t size = static_cast<size_t>(end - begin);
+    if (threads <= 1 || size == 0) {
+        parseRange(begin, end, out, nullptr);
+        return;
+    }
+
+    // 1) cut into newline-aligned chunks
+    std::vector<ObjChunk> chunks;
+    chunks.reserve(threads);
+    const char* start = begin;
+    for (int i = 0; i < threads && start < end; ++i) {
+        const char* stop = (i == threads - 1) ? end : begin + size / threads * (i + 1);
+        if (stop < start) stop = start;
+        if (stop < end) {
+            const char* nl = static_cast<const char*>(std::memchr(stop, '\n', end - stop));
+            stop = nl ? nl + 1 : end;
+        }
+        chunks.push_back(ObjChunk());
+        chunks.back().begin = start;
+        chunks.back().end = stop;
+        start = stop;
+    }
+
+    // 2) parse every chunk on its own
+    forEachChunk(chunks, [](ObjChunk& c) {
+        parseRange(c.begin, c.end, c.data, &c);
+    });
+
+    // 3) prefix sums: where each chunk's data lands in the merged arrays
+    size_t nPos = 0, nNrm = 0, nTex = 0, nCorner = 0;
+    for (auto& c : chunks) {
+        c.basePosition = nPos;
+        c.baseNormal = nNrm;
+        c.baseTexcoord = nTex;
+        c.baseCorner = nCorner;
+        nPos += c.data.positions.size();
+        nNrm += c.data.normals.size();
+        nTex += c.data.texcoords.size();
+        nCorner += c.data.corners.size();
+    }
+
+    out.positions.resize(nPos);
+    out.normals.resize(nNrm);
+    out.texcoords.resize(nTex);
+    out.corners.resize(nCorner);
+
+    // 4) copy back and turn chunk-local relative indices into global ones
+    forEachChunk(chunks, [&out](ObjChunk& c) {
+        std::copy(c.data.positions.begin(), c.data.positions.end(),
+            out.positions.begin() + c.basePosition);
+        std::copy(c.data.normals.begin(), c.data.normals.end(),
+            out.normals.begin() + c.baseNormal);
+        std::copy(c.data.texcoords.begin(), c.data.texcoords.end(),
+            out.texcoords.begin() + c.baseTexcoord);
+        std::copy(c.data.corners.begin(), c.data.corners.end(),
+            out.corners.begin() + c.baseCorner);
+
+        for (const auto& fix : c.relativeFixes) {
+            ObjCorner& oc = out.corners[c.baseCorner + fix.corner];
+            if (fix.mask & REL_V)  oc.v += static_cast<int>(c.basePosition);
+            if (fix.mask & REL_VT) oc.vt += static_cast<int>(c.baseTexcoord);
+            if (fix.mask & REL_VN) oc.vn += static_cast<int>(c.baseNormal);
+        }
+    });
+
+    // 5) stitch usemtl groups back together in file order
+    for (auto& c : chunks) {
+        for (size_t g = 0; g < c.data.groups.size(); ++g) {
+            ObjGroup& grp = c.data.groups[g];
+            grp.firstCorner += c.baseCorner;
+
+            if (g == 0 && c.leadingFaces && !out.groups.empty()) {
+                // same material as the end of the previous chunk
+                out.groups.back().cornerCount += grp.cornerCount;
+                continue;
+            }
+            out.groups.push_back(std::move(grp));
+        }
+        if (!c.data.mtllib.empty()) out.mtllib = c.data.mtllib;   // last one wins
+    }
+}
+
+bool parseOBJFile(const std::string& path, ObjData& out) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    parseOBJParallel(file.data, file.data + file.size, out,
+        objParseThreadCount(file.size));
+    return true;
+}
+
+// ---------- Vertex deduplication ----------
+
+// open-addressing map from a (v, vt, vn) triplet to its output vertex
+struct CornerMap {
+    std::vector<ObjCorner> keys;
+    std::vector<unsigned int> values;   // ~0u = empty slot
+    size_t mask = 0;
+
+    explicit CornerMap(size_t expected) {
+        size_t cap = 16;
+        while (cap < expected * 2) cap <<= 1;   // load factor <= 0.5
+        keys.resize(cap);
+        values.assign(cap, ~0u);
+        mask = cap - 1;
+    }
+
+    static size_t hash(const ObjCorner& c) {
+        unsigned long long h = static_cast<unsigned int>(c.v) * 0x9E3779B97F4A7C15ULL;
+        h ^= static_cast<unsigned int>(c.vt) * 0xC2B2AE3D27D4EB4FULL;
+        h ^= static_cast<unsigned int>(c.vn) * 0x165667B19E3779F9ULL;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+
+    // returns the slot for c; values[slot] == ~0u if it was not there yet
+    size_t find(const ObjCorner& c) const {
+        size_t i = hash(c) & mask;
+        while (values[i] != ~0u) {
+            const ObjCorner& k = keys[i];
+            if (k.v == c.v && k.vt == c.vt && k.vn == c.vn) return i;
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+};
+
+void indexCorners(const ObjData& obj, const std::vector<int>& groups,
+    std::vector<Vertex>& vertices,
+    std::vector<unsigned int>& indices) {
+    const int nV = static_cast<int>(obj.positions.size());
+    const int nVN = static_cast<int>(obj.normals.size());
+    const int nVT = static_cast<int>(obj.texcoords.size());
+
+    size_t cornerCount = 0;
+    for (int g : groups) cornerCount += obj.groups[g].cornerCount;
+
+    CornerMap map(cornerCount);
+    indices.reserve(indices.size() + cornerCount);
+
+    unsigned int nextVertex = static_cast<unsigned int>(vertices.size());
+
+    for (int g : groups) {
+        const ObjGroup& grp = obj.groups[g];
+        const size_t last = grp.firstCorner + grp.cornerCount;
+
+        for (size_t i = grp.firstCorner; i + 3 <= last; i += 3) {
+            const ObjCorner* tri = &obj.corners[i];
+
+            // drop triangles that point at positions that don't exist
+            if (tri[0].v < 0 || tri[0].v >= nV ||
+                tri[1].v < 0 || tri[1].v >= nV ||
+                tri[2].v < 0 || tri[2].v >= nV) {
+                continue;
+            }
+
+            for (int k = 0; k < 3; ++k) {
+                // out-of-range vt/vn fall back to the defaults, so they share
+                // a key with "not given"
+                ObjCorner c = tri[k];
+                if (c.vn < 0 || c.vn >= nVN) c.vn = -1;
+                if (c.vt < 0 || c.vt >= nVT) c.vt = -1;
+
+                size_t slot = map.find(c);
+                if (map.values[slot] != ~0u) {
+                    indices.push_back(map.values[slot]);
+                    continue;
+                }
+                map.keys[slot] = c;
+                map.values[slot] = nextVertex;
+                indices.push_back(nextVertex++);
+
+                const ObjFloat3& p = obj.positions[c.v];
+                Vertex v;
+                v.px = p.x;
+                v.py = p.y;
+                v.pz = p.z;
+
+                if (c.vn >= 0) {
+                    const ObjFloat3& n = obj.normals[c.vn];
+                    v.nx = n.x;
+                    v.ny = n.y;
+                    v.nz = n.z;
+                }
+                else {
+                    v.nx = 0.0f;
+                    v.ny = 1.0f;
+                    v.nz = 0.0f;
+                }
+
+                if (c.vt >= 0) {
+                    const ObjFloat2& t = obj.texcoords[c.vt];
+                    v.u = t.u;
+                    v.v = t.v;
+                }
+                else {
+                    v.u = 0.0f;
+                    v.v = 0.0f;
+                }
+
+                vertices.push_back(v);
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+// objparse.hpp
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "vertex.hpp"
+
+// Shared OBJ tokenizer used by loadOBJ (Mesh) and loadOBJWithMTL (Model).
+//
+// The file is memory-mapped and walked in place with a hand-written number
+// scanner: no streams, no locale, no per-line strings. The result is the raw
+// OBJ data (positions / normals / texcoords plus triangulated face corners
+// split into usemtl groups); the loaders turn that into their own arrays.
+
+// ---------- Memory-mapped file ----------
+
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+private:
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+};
+
+// ---------- Parsed OBJ data ----------
+
+struct ObjFloat3 { float x, y, z; };
+struct ObjFloat2 { float u, v; };
+
+// one face corner, 0-based indices (-1 = not given)
+struct ObjCorner {
+    int v, vt, vn;
+};
+
+// consecutive triangles that share one usemtl
+struct ObjGroup {
+    std::string material;      // empty = faces before any usemtl
+    size_t firstCorner = 0;    // into ObjData::corners
+    size_t cornerCount = 0;
+};
+
+struct ObjData {
+    std::vector<ObjFloat3> positions;
+    std::vector<ObjFloat3> normals;
+    std::vector<ObjFloat2> texcoords;
+    std::vector<ObjCorner> corners;   // 3 per triangle (polygons are fanned)
+    std::vector<ObjGroup>  groups;
+    std::string mtllib;               // "mtllib" argument, may contain spaces
+};
+
+// Parses [begin, end). Faces may be v, v/vt, v//vn or v/vt/vn, negative
+// (relative) indices are resolved, triangles with a bad position index are
+// dropped.
+void parseOBJ(const char* begin, const char* end, ObjData& out);
+
+// Same result as parseOBJ, but the range is cut into newline-aligned chunks
+// that are parsed on `threads` threads and then merged: a prefix sum over the
+// per-chunk counts fixes up relative indices, and faces at the start of a
+// chunk are appended to the usemtl group the previous chunk ended with.
+void parseOBJParallel(const char* begin, const char* end, ObjData& out,
+    int threads);
+
+// Parse threads for a file of this size: gObjParseThreads if > 0, otherwise
+// one per core (max 8), at most one per 256 KB.
+extern int gObjParseThreads;
+int objParseThreadCount(size_t bytes);
+
+// Maps the file and parses it (threaded for big files); false if it can't
+// be opened.
+bool parseOBJFile(const std::string& path, ObjData& out);
+
+// Turns the corners of the given groups (indices into ObjData::groups) into
+// unique vertices: every distinct (v, vt, vn) triplet is appended once to
+// `vertices` and `indices` gets a triangle list into them. Missing normals
+// become (0,1,0), missing texcoords (0,0).
+void indexCorners(const ObjData& obj, const std::vector<int>& groups,
+    std::vector<Vertex>& vertices,
+    std::vector<unsigned int>& indices);
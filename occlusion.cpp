@@ -0,0 +1,318 @@
+// occlusion.cpp
+#include "occlusion.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#else
+#define OCCLUSION_SSE 0
+#endif
+
+// ---------- Setup ----------
+
+void OcclusionBuffer::resize(int w, int h) {
+    width = std::max((w + 3) & ~3, 4);
+    height = std::max(h, 1);
+    depth.assign(static_cast<size_t>(width) * height, 1.0f);
+}
+
+void OcclusionBuffer::begin(const float m[16]) {
+    for (int i = 0; i < 16; ++i) clip[i] = m[i];
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    stats = OcclusionStats();
+}
+
+static void toClip(const float m[16], const float p[3], float out[4]) {
+    for (int r = 0; r < 4; ++r)
+        out[r] = m[r] * p[0] + m[4 + r] * p[1] + m[8 + r] * p[2] + m[12 + r];
+}
+
+// ---------- Occluders ----------
+
+void OcclusionBuffer::addBox(const float localMin[3], const float localMax[3],
+    float x, float y, float z, float ry, float sx, float sy, float sz) {
+    float a = ry * 3.14159265f / 180.0f;
+    float ca = std::cos(a), sa = std::sin(a);
+
+    // corner i has bit 0 = max x, bit 1 = max y, bit 2 = max z
+    float corners[8][3];
+    for (int i = 0; i < 8; ++i) {
+        float lx = ((i & 1) ? localMax[0] : localMin[0]) * sx;
+        float ly = ((i & 2) ? localMax[1] : localMin[1]) * sy;
+        float lz = ((i & 4) ? localMax[2] : localMin[2]) * sz;
+        corners[i][0] = x + ca * lx + sa * lz;
+        corners[i][1] = y + ly;
+        corners[i][2] = z - sa * lx + ca * lz;
+    }
+
+    static const int faces[6][4] = {
+        { 0, 2, 6, 4 }, { 1, 5, 7, 3 },   // -x, +x
+        { 0, 4, 5, 1 }, { 2, 3, 7, 6 },   // -y, +y
+        { 0, 1, 3, 2 }, { 4, 6, 7, 5 }    // -z, +z
+    };
+    for (const auto& f : faces) {
+        addTriangle(corners[f[0]], corners[f[1]], corners[f[2]]);
+        addTriangle(corners[f[0]], corners[f[2]], corners[f[3]]);
+    }
+}
+
+void OcclusionBuffer::addQuad(const float corners[4][3]) {
+    addTriangle(corners[0], corners[1], corners[2]);
+    addTriangle(corners[0], corners[2], corners[3]);
+}
+
+// Clips against the near plane (z >= -w in clip space) and fans the
+// remaining 3 or 4 corners into triangles.
+void OcclusionBuffer::addTriangle(const float* a, const float* b, const float* c) {
+    float in[3][4];
+    toClip(clip, a, in[0]);
+    toClip(clip, b, in[1]);
+    toClip(clip, c, in[2]);
+
+    float poly[4][4];
+    int count = 0;
+    for (int k = 0; k < 3; ++k) {
+        const float* p = in[k];
+        const float* q = in[(k + 1) % 3];
+        float dp = p[2] + p[3], dq = q[2] + q[3];
+        if (dp >= 0.0f) {
+            for (int i = 0; i < 4; ++i) poly[count][i] = p[i];
+            ++count;
+        }
+        if ((dp >= 0.0f) != (dq >= 0.0f)) {
+            float t = dp / (dp - dq);
+            for (int i = 0; i < 4; ++i) poly[count][i] = p[i] + (q[i] - p[i]) * t;
+            ++count;
+        }
+    }
+
+    for (int k = 1; k + 1 < count; ++k) {
+        float tri[3][4];
+        for (int i = 0; i < 4; ++i) {
+            tri[0][i] = poly[0][i];
+            tri[1][i] = poly[k][i];
+            tri[2][i] = poly[k + 1][i];
+        }
+        rasterize(tri);
+    }
+}
+
+void OcclusionBuffer::rasterize(const float v[3][4]) {
+    float sx[3], sy[3], sz[3];
+    for (int k = 0; k < 3; ++k) {
+        if (v[k][3] <= 1e-6f) return;   // on the near plane's edge, degenerate
+        float invW = 1.0f / v[k][3];
+        sx[k] = (v[k][0] * invW * 0.5f + 0.5f) * width;
+        sy[k] = (v[k][1] * invW * 0.5f + 0.5f) * height;
+        sz[k] = v[k][2] * invW;
+    }
+
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+    if (std::fabs(area) < 1e-8f) return;
+    if (area < 0.0f) {
+        // counter-clockwise, so every edge function is >= 0 inside
+        std::swap(sx[1], sx[2]);
+        std::swap(sy[1], sy[2]);
+        std::swap(sz[1], sz[2]);
+        area = -area;
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(std::min(sx[0], std::min(sx[1], sx[2])))), 0);
+    int x1 = std::min(static_cast<int>(std::ceil(std::max(sx[0], std::max(sx[1], sx[2])))), width - 1);
+    int y0 = std::max(static_cast<int>(std::floor(std::min(sy[0], std::min(sy[1], sy[2])))), 0);
+    int y1 = std::min(static_cast<int>(std::ceil(std::max(sy[0], std::max(sy[1], sy[2])))), height - 1);
+    if (x0 > x1 || y0 > y1) return;
+    stats.occluderTriangles++;
+
+    // edge k runs from corner k to k + 1: E(x, y) = A x + B y + C
+    float ea[3], eb[3], ec[3];
+    for (int k = 0; k < 3; ++k) {
+        int n = (k + 1) % 3;
+        ea[k] = -(sy[n] - sy[k]);
+        eb[k] = sx[n] - sx[k];
+        ec[k] = -(ea[k] * sx[k] + eb[k] * sy[k]);
+    }
+
+    // depth plane z = zc + zx * x + zy * y
+    float zx = ((sz[1] - sz[0]) * (sy[2] - sy[0]) - (sz[2] - sz[0]) * (sy[1] - sy[0])) / area;
+    float zy = ((sz[2] - sz[0]) * (sx[1] - sx[0]) - (sz[1] - sz[0]) * (sx[2] - sx[0])) / area;
+    float zc = sz[0] - zx * sx[0] - zy * sy[0];
+
+    x0 &= ~3;   // whole groups of four; the buffer width is a multiple of 4
+
+    for (int y = y0; y <= y1; ++y) {
+        float py = y + 0.5f;
+        float* row = &depth[static_cast<size_t>(y) * width];
+        int x = x0;
+
+#if OCCLUSION_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        for (; x <= x1; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int k = 0; k < 3; ++k) {
+                __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[k]), px),
+                    _mm_set1_ps(eb[k] * py + ec[k]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(e, zero));
+            }
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px),
+                _mm_set1_ps(zy * py + zc));
+            __m128 d = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(d, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                _mm_andnot_ps(inside, d)));
+        }
+#endif
+
+        for (; x <= x1; ++x) {
+            float px = x + 0.5f;
+            if (ea[0] * px + eb[0] * py + ec[0] < 0.0f) continue;
+            if (ea[1] * px + eb[1] * py + ec[1] < 0.0f) continue;
+            if (ea[2] * px + eb[2] * py + ec[2] < 0.0f) continue;
+            float z = zx * px + zy * py + zc;
+            if (z < row[x]) row[x] = z;
+        }
+    }
+}
+
+// ---------- Test ----------
+
+bool OcclusionBuffer::boxVisible(const WorldBox& b) {
+    stats.tested++;
+
+    float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, minZ = 1e30f;
+    for (int i = 0; i < 8; ++i) {
+        float p[3] = {
+            b.cx + ((i & 1) ? b.ex : -b.ex),
+            b.cy + ((i & 2) ? b.ey : -b.ey),
+            b.cz + ((i & 4) ? b.ez : -b.ez)
+        };
+        float c[4];
+        toClip(clip, p, c);
+
+        // reaches the near plane: the camera is at or in it, keep it
+        if (c[3] <= 1e-6f || c[2] < -c[3]) return true;
+
+        float invW = 1.0f / c[3];
+        float x = (c[0] * invW * 0.5f + 0.5f) * width;
+        float y = (c[1] * invW * 0.5f + 0.5f) * height;
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+        minZ = std::min(minZ, c[2] * invW);
+    }
+
+    int x0 = std::max(static_cast<int>(std::floor(minX)), 0);
+    int x1 = std::min(static_cast<int>(std::floor(maxX)), width - 1);
+    int y0 = std::max(static_cast<int>(std::floor(minY)), 0);
+    int y1 = std::min(static_cast<int>(std::floor(maxY)), height - 1);
+    if (x0 > x1 || y0 > y1) return true;   // off screen: the frustum test's call
+
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = &depth[static_cast<size_t>(y) * width];
+        int x = x0;
+
+#if OCCLUSION_SSE
+        const __m128 boxZ = _mm_set1_ps(minZ);
+        for (; x + 3 <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(row + x), boxZ)))
+                return true;
+        }
+#endif
+
+        for (; x <= x1; ++x)
+            if (row[x] > minZ) return true;
+    }
+
+    stats.occluded++;
+    return false;
+}
+
+// ---------- Benchmark ----------
+
+// gluPerspective(45, 1, 0.1, 300) * gluLookAt(eye, eye - z axis, +y)
+static void benchmarkCamera(float eyeX, float eyeY, float eyeZ, float out[16]) {
+    const float eye[3] = { eyeX, eyeY, eyeZ };
+    const float center[3] = { eyeX, eyeY, eyeZ - 1.0f };
+    const float up[3] = { 0.0f, 1.0f, 0.0f };
+
+    float proj[16], view[16];
+    perspectiveMatrix(45.0f, 1.0f, 0.1f, 300.0f, proj);
+    lookAtMatrix(eye, center, up, view);
+    multiplyMatrices(proj, view, out);
+}
+
+void benchmarkOcclusion(int frames, int width, int height) {
+    const float LENGTH = 200.0f, HALF_WIDTH = 2.2f, HEIGHT = 4.0f, SEGMENT = 16.0f;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> across(-1.8f, 1.8f), along(-LENGTH, -4.0f);
+
+    struct Crate { float x, z; };
+    std::vector<Crate> crates;
+    for (int i = 0; i < 40; ++i) crates.push_back({ across(rng), along(rng) });
+
+    // zombies, pickups and corridor segments to test
+    std::vector<WorldBox> boxes;
+    for (int i = 0; i < 400; ++i) boxes.push_back({ across(rng), 0.9f, along(rng), 0.4f, 0.9f, 0.4f });
+    for (int i = 0; i < 100; ++i) boxes.push_back({ across(rng), 0.3f, along(rng), 0.25f, 0.3f, 0.25f });
+    for (float z = 0.0f; z > -LENGTH; z -= SEGMENT)
+        boxes.push_back({ 0.0f, HEIGHT * 0.5f, z - SEGMENT * 0.5f, HALF_WIDTH, HEIGHT * 0.5f, SEGMENT * 0.5f });
+
+    const float crateMin[3] = { -0.5f, 0.0f, -0.5f }, crateMax[3] = { 0.5f, 1.2f, 0.5f };
+
+    OcclusionBuffer buffer;
+    buffer.resize(width, height);
+
+    double buildMs = 0.0, testMs = 0.0;
+    long long tested = 0, occluded = 0, triangles = 0;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        // walk down the corridor and back, weaving a little
+        float t = static_cast<float>(frame % 200) / 200.0f;
+        float eyeZ = -(t < 0.5f ? t : 1.0f - t) * 2.0f * (LENGTH - 20.0f);
+        float eyeX = 1.2f * std::sin(frame * 0.05f);
+        float m[16];
+        benchmarkCamera(eyeX, 1.6f, eyeZ, m);
+
+        auto t0 = std::chrono::steady_clock::now();
+        buffer.begin(m);
+        for (const auto& c : crates)
+            buffer.addBox(crateMin, crateMax, c.x, 0.0f, c.z, 0.0f, 1.0f, 1.0f, 1.0f);
+        for (float z = 0.0f; z > -LENGTH; z -= SEGMENT) {
+            for (int side = -1; side <= 1; side += 2) {
+                float wx = side * HALF_WIDTH;
+                const float wall[4][3] = {
+                    { wx, 0.0f, z }, { wx, 0.0f, z - SEGMENT },
+                    { wx, HEIGHT, z - SEGMENT }, { wx, HEIGHT, z }
+                };
+                buffer.addQuad(wall);
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        for (const auto& b : boxes) buffer.boxVisible(b);
+        auto t2 = std::chrono::steady_clock::now();
+
+        buildMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        testMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+        tested += buffer.stats.tested;
+        occluded += buffer.stats.occluded;
+        triangles += buffer.stats.occluderTriangles;
+    }
+
+    frames = std::max(frames, 1);
+    printf("Occlusion %dx%d (%s), %d frames: occluders %.3f ms (%lld triangles), "
+        "tests %.3f ms per frame; %lld of %lld boxes occluded (%.1f%%)\n",
+        buffer.width, buffer.height, OCCLUSION_SSE ? "SSE" : "scalar", frames,
+        buildMs / frames, triangles / frames, testMs / frames,
+        occluded / frames, tested / frames,
+        tested ? 100.0 * occluded / tested : 0.0);
+}
@@ -0,0 +1,20 @@
+// renderbackend.cpp
+#include "renderbackend.hpp"
+#include "renderqueue.hpp"
+
+void GLBackend::beginFrame(const float view[16], const float projection[16]) {
+    queue.setCamera(view, projection[5] * viewportHeight);
+}
+
+void GLBackend::drawMesh(const Mesh& mesh, unsigned int texId,
+    const InstanceTransform& t) {
+    queue.submitInstance(mesh, texId, t);
+}
+
+void GLBackend::drawModel(const Model& model, int lod, const InstanceTransform& t) {
+    queue.submitInstance(model, t, lod);
+}
+
+void GLBackend::endFrame() {
+    queue.flush();
+}
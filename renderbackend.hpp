@@ -0,0 +1,47 @@
+// renderbackend.hpp
+#pragma once
+#include "gpumesh.hpp"   // InstanceTransform
+
+struct Mesh;
+struct Model;
+struct RenderQueue;
+
+// ---------- Render backends ----------
+//
+// The world pass of a frame, as copies of meshes and models each placed by
+// an InstanceTransform, between beginFrame and endFrame. GLBackend hands
+// them to a RenderQueue under the camera already loaded in GL;
+// SoftwareBackend (softraster.hpp) rasterizes them on the CPU, so the same
+// scene renders with no GL context at all.
+
+struct RenderBackend {
+    virtual ~RenderBackend() {}
+
+    // view and projection, column-major as for glLoadMatrixf
+    virtual void beginFrame(const float view[16], const float projection[16]) = 0;
+
+    // texId 0 = untextured grey
+    virtual void drawMesh(const Mesh& mesh, unsigned int texId,
+        const InstanceTransform& t) = 0;
+    virtual void drawModel(const Model& model, int lod,
+        const InstanceTransform& t) = 0;
+
+    virtual void endFrame() = 0;
+};
+
+// Draws through the queue (instanced where it can) and flushes it at
+// endFrame; copies go under the view given to beginFrame, and the
+// projection is the one applyCamera already set.
+struct GLBackend : RenderBackend {
+    explicit GLBackend(RenderQueue& queue) : queue(queue) {}
+
+    void beginFrame(const float view[16], const float projection[16]) override;
+    void drawMesh(const Mesh& mesh, unsigned int texId,
+        const InstanceTransform& t) override;
+    void drawModel(const Model& model, int lod,
+        const InstanceTransform& t) override;
+    void endFrame() override;
+
+    RenderQueue& queue;
+    int viewportHeight = 0;   // pixels, for texture streaming; kept up to date by the caller
+};
@@ -0,0 +1,284 @@
+// renderqueue.cpp
+#include "renderqueue.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "texture.hpp"   // noteTextureUse
+
+#include <glut.h>
+#include "glcalls.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// eye-space distances past this all share the last depth bucket
+static const float DEPTH_RANGE = 1024.0f;
+
+static unsigned long long depthBits(float eyeDistance) {
+    float depth = std::min(std::max(eyeDistance, 0.0f), DEPTH_RANGE);
+    return static_cast<unsigned long long>(depth / DEPTH_RANGE * 0xFFFFFF);
+}
+
+// the streamer wants the bounding sphere in eye space: scaled by the
+// modelview's largest axis, centred -m[14] in front of the camera
+static void noteUse(unsigned int texId, const float m[16], float radius,
+    float screenScale) {
+    float scale = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+        const float* col = m + c * 4;
+        scale = std::max(scale, std::sqrt(col[0] * col[0] + col[1] * col[1] + col[2] * col[2]));
+    }
+    noteTextureUse(texId, -m[14], radius * scale, screenScale);
+}
+
+static void applyInstance(const InstanceTransform& t) {
+    glTranslatef(t.x, t.y, t.z);
+    glRotatef(t.ry, 0, 1, 0);
+    glScalef(t.sx, t.sy, t.sz);
+}
+
+// ---------- Submitting ----------
+
+unsigned int RenderQueue::meshId(const void* geometry) {
+    auto it = meshIds.find(geometry);
+    if (it != meshIds.end()) return it->second;
+
+    // forgotten ids first; past 65536 live meshes the 16 key bits wrap and
+    // ids are shared, which only sorts those meshes' draws apart less well
+    unsigned int id;
+    if (!freeMeshIds.empty()) {
+        id = freeMeshIds.back();
+        freeMeshIds.pop_back();
+    }
+    else id = nextMeshId++ & 0xFFFF;
+    meshIds[geometry] = id;
+    return id;
+}
+
+void RenderQueue::setCamera(const float viewMatrix[16], float scale) {
+    std::memcpy(view, viewMatrix, sizeof(view));
+    screenScale = scale;
+}
+
+void RenderQueue::push(const Mesh* mesh, const SubMesh* submesh,
+    unsigned int texId, const float modelview[16], RenderPass pass) {
+    Item item;
+    item.mesh = mesh;
+    item.submesh = submesh;
+    item.texId = texId;
+    std::memcpy(item.modelview, modelview, sizeof(item.modelview));
+
+    // the object origin is (m[12], m[13], m[14]) in eye space, looking down -z
+    const void* geometry = mesh ? static_cast<const void*>(mesh) : submesh;
+
+    item.key =
+        (static_cast<unsigned long long>(pass & 0xF) << 60) |
+        (static_cast<unsigned long long>(texId & 0xFFFFF) << 40) |
+        (static_cast<unsigned long long>(meshId(geometry)) << 24) |
+        depthBits(-item.modelview[14]);
+
+    items.push_back(item);
+    frame.items++;
+}
+
+void RenderQueue::submit(const Mesh& mesh, unsigned int texId,
+    const float modelview[16], RenderPass pass) {
+    if (texId) noteUse(texId, modelview, mesh.boundingRadius(), screenScale);
+    push(&mesh, nullptr, texId, modelview, pass);
+}
+
+void RenderQueue::submit(const Model& model, const float modelview[16],
+    RenderPass pass) {
+    for (const auto& s : model.submeshes) {
+        unsigned int texId = 0;
+        if (s.materialIndex >= 0 && s.materialIndex < (int)model.materials.size())
+            texId = model.materials[s.materialIndex].textureId;
+
+        if (texId) noteUse(texId, modelview, s.radius, screenScale);
+        push(nullptr, &s, texId, modelview, pass);
+    }
+}
+
+void RenderQueue::pushInstance(const Mesh* mesh, const SubMesh* submesh,
+    unsigned int texId, float radius, const InstanceTransform& t) {
+    const void* geometry = mesh ? static_cast<const void*>(mesh) : submesh;
+    BatchKey key(geometry, texId);
+
+    auto it = batchOf.find(key);
+    if (it == batchOf.end()) {
+        if (batchCount == (int)batches.size()) batches.push_back(Batch());
+        Batch& b = batches[batchCount];
+        b.radius = radius;
+        b.instances.clear();
+
+        // the item carries the view; its depth is fixed in flush()
+        push(mesh, submesh, texId, view, PASS_OPAQUE);
+        items.back().batch = batchCount;
+        it = batchOf.insert(std::make_pair(key, batchCount++)).first;
+    }
+    batches[it->second].instances.push_back(t);
+}
+
+void RenderQueue::submitInstance(const Mesh& mesh, unsigned int texId,
+    const InstanceTransform& t) {
+    pushInstance(&mesh, nullptr, texId, mesh.boundingRadius(), t);
+}
+
+void RenderQueue::submitInstance(const Model& model, const InstanceTransform& t,
+    int lod) {
+    for (const auto& s : model.level(lod)) {
+        unsigned int texId = 0;
+        if (s.materialIndex >= 0 && s.materialIndex < (int)model.materials.size())
+            texId = model.materials[s.materialIndex].textureId;
+        pushInstance(nullptr, &s, texId, s.radius, t);
+    }
+}
+
+// ---------- Drawing ----------
+
+// Sorts the batch by its nearest copy and reports the largest copy on
+// screen to the texture streamer (once per batch, not per copy).
+void RenderQueue::prepareBatch(Item& item) {
+    const Batch& b = batches[item.batch];
+    const float* m = item.modelview;
+
+    int nearest = -1;
+    float nearestDepth = DEPTH_RANGE, bestSize = 0.0f;
+    float bestDepth = 0.0f, bestRadius = 0.0f;
+    for (size_t i = 0; i < b.instances.size(); ++i) {
+        const InstanceTransform& t = b.instances[i];
+        float depth = -(m[2] * t.x + m[6] * t.y + m[10] * t.z + m[14]);
+        float r = b.radius * std::max(t.sx, std::max(t.sy, t.sz));
+        float size = r / std::max(depth - r, 0.01f);
+
+        nearestDepth = std::min(nearestDepth, depth);
+        if (depth + r > 0.0f && size > bestSize) {
+            bestSize = size;
+            bestDepth = depth;
+            bestRadius = r;
+            nearest = static_cast<int>(i);
+        }
+    }
+
+    item.key = (item.key & ~0xFFFFFFull) | depthBits(nearestDepth);
+
+    if (item.texId && nearest >= 0)
+        noteTextureUse(item.texId, bestDepth, bestRadius, screenScale);
+}
+
+void RenderQueue::drawBatch(const Item& item, bool textured) {
+    const Batch& b = batches[item.batch];
+    frame.instances += static_cast<int>(b.instances.size());
+
+    if (gUseInstancing && gRenderPath == RENDER_VBO && instancingAvailable()) {
+        const void* geometry = item.mesh ? static_cast<const void*>(item.mesh) : item.submesh;
+        InstanceBuffer& buffer = instanceBuffers[BatchKey(geometry, item.texId)];
+        buffer.update(b.instances);
+
+        const VertexBuffers& gpu = item.mesh ? item.mesh->gpu : item.submesh->gpu;
+        if (drawInstanced(gpu, buffer, textured)) return;
+    }
+
+    for (const auto& t : b.instances) {
+        glLoadMatrixf(item.modelview);
+        applyInstance(t);
+        if (item.mesh) item.mesh->draw(textured);
+        else item.submesh->drawGeometry();
+    }
+}
+
+void RenderQueue::flush() {
+    if (items.empty()) return;
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+
+    for (auto& item : items) {
+        if (item.batch >= 0) prepareBatch(item);
+    }
+
+    order.clear();
+    for (size_t i = 0; i < items.size(); ++i)
+        order.push_back(std::make_pair(items[i].key, static_cast<int>(i)));
+    std::sort(order.begin(), order.end());
+
+    // GL state is unknown when a flush starts (other code draws in between),
+    // so the first item sets everything
+    int texturing = -1;
+    bool overlay = false, depthWasOn = false;
+    unsigned int boundTex = 0;
+    bool bound = false;
+    float color = -1.0f;
+
+    for (const auto& o : order) {
+        const Item& item = items[o.second];
+        bool textured = item.texId != 0;
+
+        if ((item.key >> 60) == PASS_OVERLAY && !overlay) {
+            depthWasOn = glIsEnabled(GL_DEPTH_TEST) != GL_FALSE;
+            glDisable(GL_DEPTH_TEST);
+            overlay = true;
+        }
+
+        if (texturing != (int)textured) {
+            if (textured) glEnable(GL_TEXTURE_2D);
+            else glDisable(GL_TEXTURE_2D);
+            texturing = textured;
+            frame.stateChanges++;
+        }
+        else frame.redundant++;
+
+        if (textured) {
+            if (!bound || boundTex != item.texId) {
+                glBindTexture(GL_TEXTURE_2D, item.texId);
+                boundTex = item.texId;
+                bound = true;
+                frame.stateChanges++;
+            }
+            else frame.redundant++;
+        }
+
+        // white so textures aren't tinted, grey for untextured meshes
+        float c = textured ? 1.0f : 0.7f;
+        if (color != c) {
+            glColor3f(c, c, c);
+            color = c;
+            frame.stateChanges++;
+        }
+        else frame.redundant++;
+
+        glLoadMatrixf(item.modelview);
+
+        if (item.batch >= 0) drawBatch(item, textured);
+        else if (item.mesh) item.mesh->draw(textured);
+        else item.submesh->drawGeometry();
+    }
+
+    glPopMatrix();
+
+    if (texturing != 0) glDisable(GL_TEXTURE_2D);
+    if (depthWasOn) glEnable(GL_DEPTH_TEST);
+
+    items.clear();
+    batchOf.clear();
+    batchCount = 0;
+}
+
+void RenderQueue::endFrame() {
+    lastFrame = frame;
+    frame = RenderQueueStats();
+}
+
+void RenderQueue::forget(const void* geometry) {
+    // keys sort by geometry first, so its buffers (one per texture) are adjacent
+    auto it = instanceBuffers.lower_bound(BatchKey(geometry, 0));
+    while (it != instanceBuffers.end() && it->first.first == geometry) {
+        it->second.release();
+        it = instanceBuffers.erase(it);
+    }
+    auto id = meshIds.find(geometry);
+    if (id != meshIds.end()) {
+        freeMeshIds.push_back(id->second);
+        meshIds.erase(id);
+    }
+}
@@ -0,0 +1,115 @@
+// renderqueue.hpp
+#pragma once
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gpumesh.hpp"   // InstanceTransform, InstanceBuffer
+
+struct Mesh;
+struct SubMesh;
+struct Model;
+
+// ---------- Render queue ----------
+//
+// Display() submits mesh draws here instead of drawing them on the spot.
+// Each item keeps its modelview matrix, given by the caller rather than read
+// back from GL, and a 64-bit sort key, most significant first:
+//
+//   pass (4 bits) | texture (20) | mesh (16) | depth (24)
+//
+// flush() sorts on it and draws, issuing GL_TEXTURE_2D enable/disable,
+// glBindTexture and glColor calls only when they differ from
+// what the previous item left set. Within a texture and mesh, items go
+// front to back.
+//
+// Instances (submitInstance) of one mesh and texture collect into a single
+// item that is drawn with one instanced call in the VBO render path, from a
+// per-type InstanceBuffer rebuilt each flush; without instancing the copies
+// are drawn one by one.
+
+enum RenderPass {
+    PASS_OPAQUE = 0,    // world geometry, depth tested
+    PASS_OVERLAY = 1    // after everything else, depth test off (FPS gun)
+};
+
+struct RenderQueueStats {
+    int items = 0;          // draws submitted
+    int stateChanges = 0;   // texture / colour calls issued
+    int redundant = 0;      // the same calls dropped because nothing changed
+    int instances = 0;      // copies drawn through submitInstance
+};
+
+struct RenderQueue {
+    // the camera (column-major) submitInstance places copies under, and
+    // projection[5] * viewport height in pixels, for texture streaming
+    void setCamera(const float view[16], float screenScale);
+
+    // texId 0 = untextured grey, like GameObject used to draw it
+    void submit(const Mesh& mesh, unsigned int texId, const float modelview[16],
+        RenderPass pass = PASS_OPAQUE);
+
+    // one item per submesh, textured with its material
+    void submit(const Model& model, const float modelview[16],
+        RenderPass pass = PASS_OPAQUE);
+
+    // One more copy of the mesh / model, placed by `t` relative to the
+    // view from setView; cheap enough for thousands.
+    // Each LOD of a model is its own geometry, batched separately.
+    void submitInstance(const Mesh& mesh, unsigned int texId,
+        const InstanceTransform& t);
+    void submitInstance(const Model& model, const InstanceTransform& t,
+        int lod = 0);
+
+    // draws and clears everything submitted so far; leaves texturing off
+    void flush();
+
+    // moves this frame's counts (all flushes) to lastFrame
+    void endFrame();
+
+    // drops what the queue keeps per mesh / submesh across frames (its
+    // instance buffers and sort id), before that geometry is freed; not
+    // between submitting it and flush()
+    void forget(const void* geometry);
+
+    RenderQueueStats lastFrame;
+
+private:
+    struct Item {
+        unsigned long long key = 0;
+        float modelview[16];
+        const Mesh* mesh = nullptr;
+        const SubMesh* submesh = nullptr;
+        unsigned int texId = 0;
+        int batch = -1;             // into batches, for instanced items
+    };
+
+    struct Batch {
+        float radius = 0.0f;        // of the geometry, for texture streaming
+        std::vector<InstanceTransform> instances;
+    };
+
+    typedef std::pair<const void*, unsigned int> BatchKey;   // geometry, texture
+
+    void push(const Mesh* mesh, const SubMesh* submesh, unsigned int texId,
+        const float modelview[16], RenderPass pass);
+    void pushInstance(const Mesh* mesh, const SubMesh* submesh,
+        unsigned int texId, float radius, const InstanceTransform& t);
+    void prepareBatch(Item& item);
+    void drawBatch(const Item& item, bool textured);
+    unsigned int meshId(const void* geometry);
+
+    float view[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    float screenScale = 0.0f;
+    std::vector<Item> items;
+    std::vector<Batch> batches;             // the first batchCount are in use
+    int batchCount = 0;
+    std::map<BatchKey, int> batchOf;        // this flush's batch per type
+    std::map<BatchKey, InstanceBuffer> instanceBuffers;   // kept across frames
+    std::vector<std::pair<unsigned long long, int>> order;
+    std::unordered_map<const void*, unsigned int> meshIds;
+    std::vector<unsigned int> freeMeshIds;  // given back by forget()
+    unsigned int nextMeshId = 0;
+    RenderQueueStats frame;
+};
@@ -0,0 +1,63 @@
+// segmentstream.cpp
+#include "segmentstream.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// [first, last] segment indices that touch [position - behind, position + ahead]
+static void wantedRange(const SegmentStreamer& s, float position,
+    int& first, int& last) {
+    first = static_cast<int>(std::floor((position - s.behind) / s.step));
+    last = static_cast<int>(std::floor((position + s.ahead) / s.step));
+    first = std::max(first, 0);
+    if (s.levelSegments > 0) last = std::min(last, s.levelSegments - 1);
+}
+
+bool SegmentStreamer::reset(float segmentStep, float viewAhead, float viewBehind,
+    int segmentCount, float position) {
+    slots.clear();
+    recycled = 0;
+    if (!(segmentStep > 0.0f)) return false;
+
+    step = segmentStep;
+    ahead = viewAhead;
+    behind = viewBehind;
+    levelSegments = segmentCount;
+
+    // a range of length L touches at most floor(L / step) + 2 segments
+    int poolSize = static_cast<int>(std::floor((ahead + behind) / step)) + 2;
+    if (levelSegments > 0) poolSize = std::min(poolSize, levelSegments);
+
+    slots.assign(poolSize, -1);
+    recycled = 0;
+    update(position);
+    recycled = 0;
+    return true;
+}
+
+int SegmentStreamer::update(float position) {
+    if (slots.empty()) return 0;
+
+    int first, last;
+    wantedRange(*this, position, first, last);
+
+    // free the slots that left the range, then fill the indices nobody shows
+    std::vector<char> shown(std::max(last - first + 1, 0), 0);
+    std::vector<int> freeSlots;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] >= first && slots[i] <= last) shown[slots[i] - first] = 1;
+        else freeSlots.push_back(static_cast<int>(i));
+    }
+
+    int moved = 0;
+    size_t next = 0;
+    for (int seg = first; seg <= last && next < freeSlots.size(); ++seg) {
+        if (shown[seg - first]) continue;
+        slots[freeSlots[next++]] = seg;
+        ++moved;
+    }
+    for (; next < freeSlots.size(); ++next) slots[freeSlots[next]] = -1;
+
+    recycled += moved;
+    return moved;
+}
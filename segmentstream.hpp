@@ -0,0 +1,33 @@
+// segmentstream.hpp
+#pragma once
+#include <vector>
+
+// ---------- Segment streaming ----------
+//
+// Keeps a level built from identical segments (segment i starts i * step
+// along the level) down to the few around the player. The pool of slots
+// is sized once for the view range; when the player moves on, slots that
+// fell out of range are handed the segment indices that came into range,
+// so a level of any length costs the same memory and draws.
+
+struct SegmentStreamer {
+    float step = 1.0f;          // length of one segment
+    float ahead = 0.0f;         // view distance in front of the player
+    float behind = 0.0f;        // and behind
+    int levelSegments = 0;      // 0 = endless
+
+    // segment index each slot shows, -1 = idle (level shorter than the pool)
+    std::vector<int> slots;
+
+    // sizes the pool for the view range and places it around `position`;
+    // false, with an empty pool, if step isn't positive
+    bool reset(float step, float ahead, float behind, int levelSegments,
+        float position);
+
+    // position = distance along the level (>= 0 from its start); returns
+    // how many slots were given a new segment. Slots left with nothing in
+    // range go idle until one comes up.
+    int update(float position);
+
+    int recycled = 0;           // segments placed since reset
+};
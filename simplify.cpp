@@ -0,0 +1,261 @@
+// simplify.cpp
+#include "simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// ---------- Quadrics ----------
+
+// symmetric 4x4 plane quadric, plus the area it was accumulated from
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+    double w = 0;
+
+    void addPlane(double a, double b, double c, double d, double weight) {
+        a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+        b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+        c2 += weight * c * c; cd += weight * c * d;
+        d2 += weight * d * d;
+        w += weight;
+    }
+
+    void add(const Quadric& q) {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        w += q.w;
+    }
+
+    // weighted sum of squared distances of (x, y, z) to the planes
+    double error(double x, double y, double z) const {
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x +
+            b2 * y * y + 2 * bc * y * z + 2 * bd * y +
+            c2 * z * z + 2 * cd * z +
+            d2;
+    }
+};
+
+// mean squared distance of moving onto v with the planes of a and b
+static double collapseError(const Quadric& a, const Quadric& b, const Vertex& v) {
+    Quadric q = a;
+    q.add(b);
+    double e = q.error(v.px, v.py, v.pz);
+    return q.w > 0 ? std::max(e, 0.0) / q.w : 0.0;
+}
+
+static void triangleNormal(const Vertex& a, const Vertex& b, const Vertex& c,
+    double n[3]) {
+    double ux = b.px - a.px, uy = b.py - a.py, uz = b.pz - a.pz;
+    double vx = c.px - a.px, vy = c.py - a.py, vz = c.pz - a.pz;
+    n[0] = uy * vz - uz * vy;
+    n[1] = uz * vx - ux * vz;
+    n[2] = ux * vy - uy * vx;
+}
+
+// ---------- Topology ----------
+
+// first vertex with each position; seam vertices share their position
+static void weldPositions(const std::vector<Vertex>& vertices,
+    std::vector<unsigned int>& posOf) {
+    struct Key {
+        float p[3];
+        bool operator==(const Key& o) const { return std::memcmp(p, o.p, sizeof(p)) == 0; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            unsigned int h[3];
+            std::memcpy(h, k.p, sizeof(h));
+            return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+        }
+    };
+
+    std::unordered_map<Key, unsigned int, KeyHash> first;
+    first.reserve(vertices.size());
+    posOf.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        Key k = { { vertices[i].px, vertices[i].py, vertices[i].pz } };
+        posOf[i] = first.insert(std::make_pair(k, static_cast<unsigned int>(i))).first->second;
+    }
+}
+
+// vertices that may move: a position used by this vertex only, with every
+// edge around it shared by two triangles
+static void findMovable(const std::vector<unsigned int>& indices,
+    const std::vector<unsigned int>& posOf,
+    std::vector<char>& movable) {
+    size_t n = posOf.size();
+    movable.assign(n, 1);
+
+    std::vector<int> usesOfPos(n, 0);
+    for (size_t i = 0; i < n; ++i) usesOfPos[posOf[i]]++;
+    for (size_t i = 0; i < n; ++i)
+        if (usesOfPos[posOf[i]] > 1) movable[i] = 0;
+
+    // an edge is open when the opposite direction is missing; matched on
+    // positions, so edges along a seam count as closed
+    std::unordered_map<unsigned long long, int> edges;
+    edges.reserve(indices.size());
+    auto edgeKey = [&](unsigned int a, unsigned int b) {
+        return (static_cast<unsigned long long>(posOf[a]) << 32) | posOf[b];
+    };
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        for (int k = 0; k < 3; ++k)
+            edges[edgeKey(indices[t + k], indices[t + (k + 1) % 3])]++;
+
+    std::vector<char> openPos(n, 0);
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            unsigned int a = indices[t + k], b = indices[t + (k + 1) % 3];
+            if (edges.find(edgeKey(b, a)) == edges.end())
+                openPos[posOf[a]] = openPos[posOf[b]] = 1;
+        }
+    }
+    for (size_t i = 0; i < n; ++i)
+        if (openPos[posOf[i]]) movable[i] = 0;
+}
+
+// ---------- Simplification ----------
+
+std::vector<unsigned int> simplifyMesh(const std::vector<unsigned int>& input,
+    const std::vector<Vertex>& vertices,
+    size_t targetIndexCount,
+    float maxError,
+    float* outError) {
+    std::vector<unsigned int> indices(input.begin(), input.end() - input.size() % 3);
+    size_t n = vertices.size();
+    double maxError2 = static_cast<double>(maxError) * maxError;
+    double usedError2 = 0.0;
+
+    std::vector<unsigned int> posOf;
+    std::vector<char> movable;
+    weldPositions(vertices, posOf);
+    findMovable(indices, posOf, movable);
+
+    std::vector<Quadric> quadric(n);
+    for (size_t t = 0; t < indices.size(); t += 3) {
+        const Vertex& a = vertices[indices[t]];
+        double nrm[3];
+        triangleNormal(a, vertices[indices[t + 1]], vertices[indices[t + 2]], nrm);
+        double len = std::sqrt(nrm[0] * nrm[0] + nrm[1] * nrm[1] + nrm[2] * nrm[2]);
+        if (len <= 0.0) continue;
+
+        double nx = nrm[0] / len, ny = nrm[1] / len, nz = nrm[2] / len;
+        double d = -(nx * a.px + ny * a.py + nz * a.pz);
+        for (int k = 0; k < 3; ++k)
+            quadric[posOf[indices[t + k]]].addPlane(nx, ny, nz, d, len * 0.5);
+    }
+
+    std::vector<unsigned int> remap(n);
+    std::vector<unsigned int> bestTarget(n);
+    std::vector<double> bestCost(n);
+    std::vector<unsigned int> order;
+    std::vector<char> touched(n);
+    std::vector<unsigned int> triStart(n + 1), triList;
+
+    while (indices.size() > targetIndexCount) {
+        size_t triCount = indices.size() / 3;
+
+        // triangles around each vertex
+        std::fill(triStart.begin(), triStart.end(), 0);
+        for (unsigned int v : indices) triStart[v + 1]++;
+        for (size_t i = 0; i < n; ++i) triStart[i + 1] += triStart[i];
+        triList.resize(indices.size());
+        {
+            std::vector<unsigned int> fill(triStart.begin(), triStart.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+                triList[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // cheapest neighbour to move each movable vertex onto
+        std::fill(bestCost.begin(), bestCost.end(), -1.0);
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            for (int k = 0; k < 3; ++k) {
+                for (int j = 1; j < 3; ++j) {
+                    unsigned int a = indices[t + k], b = indices[t + (k + j) % 3];
+                    if (!movable[a]) continue;
+                    double cost = collapseError(quadric[posOf[a]], quadric[posOf[b]], vertices[b]);
+                    if (bestCost[a] < 0.0 || cost < bestCost[a]) {
+                        bestCost[a] = cost;
+                        bestTarget[a] = b;
+                    }
+                }
+            }
+        }
+
+        order.clear();
+        for (size_t i = 0; i < n; ++i)
+            if (bestCost[i] >= 0.0 && bestCost[i] <= maxError2)
+                order.push_back(static_cast<unsigned int>(i));
+        std::sort(order.begin(), order.end(), [&](unsigned int x, unsigned int y) {
+            return bestCost[x] < bestCost[y];
+        });
+
+        for (size_t i = 0; i < n; ++i) remap[i] = static_cast<unsigned int>(i);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        // collapse cheapest first; a vertex takes part in one collapse per
+        // pass, so every triangle it touches still has its pass-start shape
+        // apart from vertices already moved, which remap resolves
+        size_t collapses = 0;
+        size_t trianglesLeft = triCount;
+        size_t targetTriangles = targetIndexCount / 3;
+        for (unsigned int a : order) {
+            if (trianglesLeft <= targetTriangles) break;
+            unsigned int b = bestTarget[a];
+            if (touched[a] || touched[b]) continue;
+
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int ti = triStart[a]; ti < triStart[a + 1] && !flips; ++ti) {
+                unsigned int tri[3];
+                for (int k = 0; k < 3; ++k) tri[k] = remap[indices[triList[ti] * 3 + k]];
+                if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2]) continue;
+                if (tri[0] == b || tri[1] == b || tri[2] == b) {
+                    ++removed;
+                    continue;
+                }
+
+                double before[3], after[3];
+                triangleNormal(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], before);
+                for (int k = 0; k < 3; ++k)
+                    if (tri[k] == a) tri[k] = b;
+                triangleNormal(vertices[tri[0]], vertices[tri[1]], vertices[tri[2]], after);
+
+                double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                double lb = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+                double la = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+                if (dot <= 0.25 * lb * la) flips = true;
+            }
+            if (flips) continue;
+
+            remap[a] = b;
+            quadric[posOf[b]].add(quadric[posOf[a]]);
+            touched[a] = touched[b] = 1;
+            usedError2 = std::max(usedError2, bestCost[a]);
+            trianglesLeft -= std::min(removed, trianglesLeft);
+            ++collapses;
+        }
+
+        if (collapses == 0) break;
+
+        // apply the pass, dropping triangles that lost a corner
+        size_t out = 0;
+        for (size_t t = 0; t < indices.size(); t += 3) {
+            unsigned int i0 = remap[indices[t]], i1 = remap[indices[t + 1]], i2 = remap[indices[t + 2]];
+            if (i0 == i1 || i1 == i2 || i0 == i2) continue;
+            indices[out++] = i0;
+            indices[out++] = i1;
+            indices[out++] = i2;
+        }
+        indices.resize(out);
+    }
+
+    if (outError) *outError = static_cast<float>(std::sqrt(usedError2));
+    return indices;
+}
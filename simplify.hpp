@@ -0,0 +1,33 @@
+// simplify.hpp
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "vertex.hpp"
+
+// ---------- Mesh simplification ----------
+//
+// Quadric error edge collapse (Garland & Heckbert), run at import time to
+// build LOD levels. Each vertex carries the area-weighted sum of the planes
+// of its triangles; collapsing a vertex onto a neighbour costs the mean
+// squared distance of that neighbour to both vertices' planes. Cheapest
+// collapses go first, in passes, until the triangle target or the error
+// limit is reached.
+//
+// Collapses are half-edge: a vertex moves onto an existing neighbour and
+// takes its attributes, so the vertex array is shared with the input and
+// no new vertices are made. Vertices on an open edge (mesh or material
+// border, as a SubMesh is one material) and on UV / normal seams (one
+// position, several vertices) never move, which keeps those boundaries
+// exactly where they were. Collapses that would flip a triangle are
+// skipped.
+
+// Returns the simplified triangle list over the same vertices: at most
+// targetIndexCount indices if that is reachable within maxError (a
+// distance, in the mesh's units). outError, if given, gets the largest
+// error actually used.
+std::vector<unsigned int> simplifyMesh(const std::vector<unsigned int>& indices,
+    const std::vector<Vertex>& vertices,
+    size_t targetIndexCount,
+    float maxError,
+    float* outError = nullptr);
@@ -0,0 +1,470 @@
+// softraster.cpp
+#include "softraster.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "frustum.hpp"   // multiplyMatrices
+#include "mipmap.hpp"
+#include "texture.hpp"   // texturePath, loadMipChain
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFT_SSE 1
+#include <emmintrin.h>
+#else
+#define SOFT_SSE 0
+#endif
+
+static const int TILE_SIZE = 64;
+
+// ---------- Framebuffer ----------
+
+unsigned long long SoftFramebuffer::hash() const {
+    unsigned long long h = 1469598103934665603ull;
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(&color[static_cast<size_t>(y) * stride]);
+        for (int i = 0; i < width * 4; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+bool SoftFramebuffer::writePPM(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; --y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned int c = color[static_cast<size_t>(y) * stride + x];
+            row[x * 3 + 0] = c & 0xFF;
+            row[x * 3 + 1] = (c >> 8) & 0xFF;
+            row[x * 3 + 2] = (c >> 16) & 0xFF;
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// ---------- Setup ----------
+
+SoftRasterizer::~SoftRasterizer() {
+    resize(0, 0, 1);
+}
+
+void SoftRasterizer::resize(int width, int height, int threads) {
+    {
+        std::lock_guard<std::mutex> l(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+    workers.clear();
+    stopping = false;
+
+    target.width = std::max(width, 0);
+    target.height = std::max(height, 0);
+    target.stride = (target.width + 3) & ~3;
+    target.color.assign(static_cast<size_t>(target.stride) * target.height, 0);
+    target.depth.assign(target.color.size(), 1.0f);
+
+    tilesX = (target.stride + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (target.height + TILE_SIZE - 1) / TILE_SIZE;
+    bins.assign(static_cast<size_t>(tilesX) * tilesY, std::vector<unsigned int>());
+
+    if (width <= 0 || height <= 0) return;
+
+    // the generation they start from is taken here, not once they run: a
+    // finish() before a new thread gets going would otherwise bump it
+    // first, and that thread would sleep through the frame it owes
+    unsigned int start;
+    {
+        std::lock_guard<std::mutex> l(lock);
+        start = generation;
+    }
+    if (threads <= 0) threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    for (int i = 1; i < threads; ++i)
+        workers.emplace_back(&SoftRasterizer::workerLoop, this, start);
+}
+
+void SoftRasterizer::clear(unsigned int rgba) {
+    std::fill(target.color.begin(), target.color.end(), rgba);
+    std::fill(target.depth.begin(), target.depth.end(), 1.0f);
+    triangles.clear();
+    for (auto& b : bins) b.clear();
+    stats = SoftRasterStats();
+}
+
+// ---------- Geometry ----------
+
+void SoftRasterizer::drawIndexed(const std::vector<Vertex>& vertices,
+    const IndexBuffer& indices, const float m[16], const SoftTexture* texture,
+    unsigned int color) {
+    if (vertices.empty() || indices.empty() || target.width == 0) return;
+
+    clipVerts.resize(vertices.size() * 4);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        float* c = &clipVerts[i * 4];
+        for (int r = 0; r < 4; ++r)
+            c[r] = m[r] * v.px + m[4 + r] * v.py + m[8 + r] * v.pz + m[12 + r];
+    }
+
+    int n = indices.size();
+    for (int t = 0; t + 2 < n; t += 3) {
+        stats.triangles++;
+
+        float in[3][6];
+        for (int k = 0; k < 3; ++k) {
+            unsigned int i = indices[t + k];
+            const float* c = &clipVerts[i * 4];
+            in[k][0] = c[0]; in[k][1] = c[1]; in[k][2] = c[2]; in[k][3] = c[3];
+            in[k][4] = vertices[i].u;
+            in[k][5] = vertices[i].v;
+        }
+
+        // all three outside the same side plane (or beyond far): nothing to draw
+        bool out = false;
+        for (int axis = 0; axis < 3 && !out; ++axis) {
+            if (in[0][axis] > in[0][3] && in[1][axis] > in[1][3] && in[2][axis] > in[2][3]) out = true;
+            if (axis < 2 && in[0][axis] < -in[0][3] && in[1][axis] < -in[1][3] && in[2][axis] < -in[2][3]) out = true;
+        }
+        if (out) continue;
+
+        // near plane (z >= -w), as a polygon of up to 4 corners
+        float poly[4][6];
+        int count = 0;
+        for (int k = 0; k < 3; ++k) {
+            const float* p = in[k];
+            const float* q = in[(k + 1) % 3];
+            float dp = p[2] + p[3], dq = q[2] + q[3];
+            if (dp >= 0.0f) {
+                for (int i = 0; i < 6; ++i) poly[count][i] = p[i];
+                ++count;
+            }
+            if ((dp >= 0.0f) != (dq >= 0.0f)) {
+                float s = dp / (dp - dq);
+                for (int i = 0; i < 6; ++i) poly[count][i] = p[i] + (q[i] - p[i]) * s;
+                ++count;
+            }
+        }
+
+        for (int k = 1; k + 1 < count; ++k) {
+            float tri[3][6];
+            for (int i = 0; i < 6; ++i) {
+                tri[0][i] = poly[0][i];
+                tri[1][i] = poly[k][i];
+                tri[2][i] = poly[k + 1][i];
+            }
+            setupTriangle(tri, texture, color);
+        }
+    }
+}
+
+void SoftRasterizer::setupTriangle(const float v[3][6], const SoftTexture* texture,
+    unsigned int color) {
+    float sx[3], sy[3], sz[3], iw[3], uw[3], vw[3];
+    for (int k = 0; k < 3; ++k) {
+        if (v[k][3] <= 1e-6f) return;
+        iw[k] = 1.0f / v[k][3];
+        sx[k] = (v[k][0] * iw[k] * 0.5f + 0.5f) * target.width;
+        sy[k] = (v[k][1] * iw[k] * 0.5f + 0.5f) * target.height;
+        sz[k] = v[k][2] * iw[k];
+        uw[k] = v[k][4] * iw[k];
+        vw[k] = v[k][5] * iw[k];
+    }
+
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+    if (!(std::fabs(area) > 1e-8f)) return;
+
+    Triangle tri;
+    tri.x0 = std::max(static_cast<int>(std::floor(std::min(sx[0], std::min(sx[1], sx[2])))), 0);
+    tri.x1 = std::min(static_cast<int>(std::ceil(std::max(sx[0], std::max(sx[1], sx[2])))), target.width - 1);
+    tri.y0 = std::max(static_cast<int>(std::floor(std::min(sy[0], std::min(sy[1], sy[2])))), 0);
+    tri.y1 = std::min(static_cast<int>(std::ceil(std::max(sy[0], std::max(sy[1], sy[2])))), target.height - 1);
+    if (tri.x0 > tri.x1 || tri.y0 > tri.y1) return;
+
+    // edges of the counter-clockwise order, so inside is >= 0 on all three
+    int order[3] = { 0, 1, 2 };
+    if (area < 0.0f) std::swap(order[1], order[2]);
+    for (int k = 0; k < 3; ++k) {
+        int a = order[k], b = order[(k + 1) % 3];
+        tri.ea[k] = -(sy[b] - sy[a]);
+        tri.eb[k] = sx[b] - sx[a];
+        tri.ec[k] = -(tri.ea[k] * sx[a] + tri.eb[k] * sy[a]);
+    }
+
+    // attributes affine in screen space: z / w (GL's depth), 1/w, u/w, v/w
+    auto plane = [&](const float a[3], float& dx, float& dy, float& c) {
+        dx = ((a[1] - a[0]) * (sy[2] - sy[0]) - (a[2] - a[0]) * (sy[1] - sy[0])) / area;
+        dy = ((a[2] - a[0]) * (sx[1] - sx[0]) - (a[1] - a[0]) * (sx[2] - sx[0])) / area;
+        c = a[0] - dx * sx[0] - dy * sy[0];
+    };
+    plane(sz, tri.zx, tri.zy, tri.zc);
+    plane(iw, tri.wx, tri.wy, tri.wc);
+    plane(uw, tri.ux, tri.uy, tri.uc);
+    plane(vw, tri.vx, tri.vy, tri.vc);
+
+    // mip level from texels per pixel over the whole triangle
+    tri.texture = nullptr;
+    tri.color = color;
+    if (texture && !texture->levels.empty()) {
+        const SoftTextureLevel& top = texture->levels[0];
+        float u[3], t[3];
+        for (int k = 0; k < 3; ++k) {
+            u[k] = uw[k] / iw[k];
+            t[k] = vw[k] / iw[k];
+        }
+        float texels = std::fabs((u[1] - u[0]) * (t[2] - t[0]) - (u[2] - u[0]) * (t[1] - t[0])) *
+            top.width * top.height;
+        int level = 0;
+        if (texels > std::fabs(area)) {
+            level = static_cast<int>(std::floor(0.5f * std::log2(texels / std::fabs(area)) + 0.5f));
+            level = std::min(level, static_cast<int>(texture->levels.size()) - 1);
+        }
+        tri.texture = &texture->levels[level];
+    }
+
+    unsigned int id = static_cast<unsigned int>(triangles.size());
+    triangles.push_back(tri);
+    stats.rasterized++;
+
+    for (int ty = tri.y0 / TILE_SIZE; ty <= tri.y1 / TILE_SIZE; ++ty) {
+        for (int tx = tri.x0 / TILE_SIZE; tx <= tri.x1 / TILE_SIZE; ++tx) {
+            bins[ty * tilesX + tx].push_back(id);
+            stats.binned++;
+        }
+    }
+}
+
+// ---------- Rasterization ----------
+
+static unsigned int sampleNearest(const SoftTextureLevel& t, float u, float v) {
+    int x = static_cast<int>(std::floor(u * t.width)) % t.width;
+    int y = static_cast<int>(std::floor(v * t.height)) % t.height;
+    if (x < 0) x += t.width;
+    if (y < 0) y += t.height;
+    return t.texels[static_cast<size_t>(y) * t.width + x];
+}
+
+void SoftRasterizer::rasterizeTile(int tile) {
+    int tx0 = (tile % tilesX) * TILE_SIZE, ty0 = (tile / tilesX) * TILE_SIZE;
+    int tx1 = std::min(tx0 + TILE_SIZE, target.stride) - 1;
+    int ty1 = std::min(ty0 + TILE_SIZE, target.height) - 1;
+    const int stride = target.stride;
+
+    for (unsigned int id : bins[tile]) {
+        const Triangle& tri = triangles[id];
+        int x0 = std::max(tri.x0, tx0) & ~3;   // tiles start on multiples of 4
+        int x1 = std::min(tri.x1, tx1);
+        int y0 = std::max(tri.y0, ty0), y1 = std::min(tri.y1, ty1);
+
+        for (int y = y0; y <= y1; ++y) {
+            float py = y + 0.5f;
+            unsigned int* colorRow = &target.color[static_cast<size_t>(y) * stride];
+            float* depthRow = &target.depth[static_cast<size_t>(y) * stride];
+            int x = x0;
+
+#if SOFT_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 e0 = _mm_set1_ps(tri.eb[0] * py + tri.ec[0]);
+            __m128 e1 = _mm_set1_ps(tri.eb[1] * py + tri.ec[1]);
+            __m128 e2 = _mm_set1_ps(tri.eb[2] * py + tri.ec[2]);
+            __m128 zRow = _mm_set1_ps(tri.zy * py + tri.zc);
+
+            for (; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+                __m128 inside = _mm_and_ps(
+                    _mm_and_ps(
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.ea[0]), px), e0), zero),
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.ea[1]), px), e1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.ea[2]), px), e2), zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.zx), px), zRow);
+                __m128 d = _mm_loadu_ps(depthRow + x);
+                __m128 pass = _mm_and_ps(inside,
+                    _mm_and_ps(_mm_cmplt_ps(z, d), _mm_cmple_ps(z, one)));
+                int mask = _mm_movemask_ps(pass);
+                if (mask == 0) continue;
+
+                _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, d)));
+
+                if (!tri.texture) {
+                    for (int k = 0; k < 4; ++k)
+                        if (mask & (1 << k)) colorRow[x + k] = tri.color;
+                    continue;
+                }
+
+                // perspective-correct u, v for the four lanes at once
+                __m128 w = _mm_div_ps(one, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.wx), px),
+                    _mm_set1_ps(tri.wy * py + tri.wc)));
+                __m128 u = _mm_mul_ps(w, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.ux), px),
+                    _mm_set1_ps(tri.uy * py + tri.uc)));
+                __m128 v = _mm_mul_ps(w, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.vx), px),
+                    _mm_set1_ps(tri.vy * py + tri.vc)));
+                float us[4], vs[4];
+                _mm_storeu_ps(us, u);
+                _mm_storeu_ps(vs, v);
+                for (int k = 0; k < 4; ++k)
+                    if (mask & (1 << k)) colorRow[x + k] = sampleNearest(*tri.texture, us[k], vs[k]);
+            }
+#endif
+
+            // same operation order as the SSE path, so both give the same bits
+            for (; x <= x1; ++x) {
+                float px = x + 0.5f;
+                if (tri.ea[0] * px + (tri.eb[0] * py + tri.ec[0]) < 0.0f) continue;
+                if (tri.ea[1] * px + (tri.eb[1] * py + tri.ec[1]) < 0.0f) continue;
+                if (tri.ea[2] * px + (tri.eb[2] * py + tri.ec[2]) < 0.0f) continue;
+
+                float z = tri.zx * px + (tri.zy * py + tri.zc);
+                if (!(z < depthRow[x]) || z > 1.0f) continue;
+                depthRow[x] = z;
+
+                if (!tri.texture) {
+                    colorRow[x] = tri.color;
+                    continue;
+                }
+                float w = 1.0f / (tri.wx * px + (tri.wy * py + tri.wc));
+                float u = w * (tri.ux * px + (tri.uy * py + tri.uc));
+                float v = w * (tri.vx * px + (tri.vy * py + tri.vc));
+                colorRow[x] = sampleNearest(*tri.texture, u, v);
+            }
+        }
+    }
+}
+
+void SoftRasterizer::rasterizeTiles() {
+    const int count = tilesX * tilesY;
+    for (;;) {
+        int tile = nextTile++;
+        if (tile >= count) break;
+        rasterizeTile(tile);
+    }
+}
+
+void SoftRasterizer::workerLoop(unsigned int seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            wake.wait(l, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        rasterizeTiles();
+
+        std::lock_guard<std::mutex> l(lock);
+        if (--busy == 0) finished.notify_one();
+    }
+}
+
+void SoftRasterizer::finish() {
+    {
+        std::lock_guard<std::mutex> l(lock);
+        nextTile = 0;
+        busy = static_cast<int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    rasterizeTiles();
+
+    std::unique_lock<std::mutex> l(lock);
+    finished.wait(l, [&] { return busy == 0; });
+}
+
+// ---------- Backend ----------
+
+static const unsigned int SOFT_CLEAR = 0xFFFFFFFFu;   // glClearColor(1, 1, 1, 0), alpha unused
+static const unsigned int SOFT_GREY = 0xFFB3B3B3u;    // glColor3f(0.7, 0.7, 0.7)
+static const unsigned int SOFT_LOADING = 0xFFB2B2B2u; // the texture placeholder
+
+// translate(x, y, z) * rotateY(ry) * scale(sx, sy, sz)
+static void instanceMatrix(const InstanceTransform& t, float m[16]) {
+    float a = t.ry * 3.14159265f / 180.0f;
+    float c = std::cos(a), s = std::sin(a);
+    for (int i = 0; i < 16; ++i) m[i] = 0.0f;
+    m[0] = c * t.sx;  m[2] = -s * t.sx;
+    m[5] = t.sy;
+    m[8] = s * t.sz;  m[10] = c * t.sz;
+    m[12] = t.x; m[13] = t.y; m[14] = t.z; m[15] = 1.0f;
+}
+
+void SoftwareBackend::beginFrame(const float view[16], const float projection[16]) {
+    multiplyMatrices(projection, view, viewProjection);
+    raster.clear(SOFT_CLEAR);
+}
+
+const SoftTexture* SoftwareBackend::textureFor(unsigned int texId) {
+    auto it = textures.find(texId);
+    if (it != textures.end()) return it->second.levels.empty() ? nullptr : &it->second;
+
+    SoftTexture& tex = textures[texId];
+    MipChain chain;
+    std::string path = texturePath(texId);
+    if (path.empty() || !loadMipChain(path, chain)) {
+        printf("Software renderer: no texture %u (%s)\n", texId, path.c_str());
+        return nullptr;
+    }
+
+    for (const MipLevel& l : chain.levels) {
+        SoftTextureLevel level;
+        level.width = l.width;
+        level.height = l.height;
+        level.texels.resize(static_cast<size_t>(l.width) * l.height);
+        for (size_t i = 0; i < level.texels.size(); ++i) {
+            const unsigned char* p = &l.pixels[i * chain.channels];
+            unsigned int r, g, b, a = 255;
+            switch (chain.channels) {
+            case 1:  r = g = b = p[0]; break;
+            case 2:  r = g = b = p[0]; a = p[1]; break;
+            case 4:  r = p[0]; g = p[1]; b = p[2]; a = p[3]; break;
+            default: r = p[0]; g = p[1]; b = p[2]; break;
+            }
+            level.texels[i] = r | (g << 8) | (b << 16) | (a << 24);
+        }
+        tex.levels.push_back(std::move(level));
+    }
+    return tex.levels.empty() ? nullptr : &tex;
+}
+
+void SoftwareBackend::draw(const std::vector<Vertex>& vertices,
+    const IndexBuffer& indices, unsigned int texId, const InstanceTransform& t) {
+    float model[16], mvp[16];
+    instanceMatrix(t, model);
+    multiplyMatrices(viewProjection, model, mvp);
+
+    const SoftTexture* texture = texId ? textureFor(texId) : nullptr;
+    unsigned int color = texId ? SOFT_LOADING : SOFT_GREY;
+    raster.drawIndexed(vertices, indices, mvp, texture, color);
+}
+
+void SoftwareBackend::drawMesh(const Mesh& mesh, unsigned int texId,
+    const InstanceTransform& t) {
+    draw(mesh.vertices, mesh.indices, texId, t);
+}
+
+void SoftwareBackend::drawModel(const Model& model, int lod, const InstanceTransform& t) {
+    for (const auto& s : model.level(lod)) {
+        unsigned int texId = 0;
+        if (s.materialIndex >= 0 && s.materialIndex < (int)model.materials.size())
+            texId = model.materials[s.materialIndex].textureId;
+        draw(s.vertices, s.indices, texId, t);
+    }
+}
+
+void SoftwareBackend::endFrame() {
+    raster.finish();
+}
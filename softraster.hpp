@@ -0,0 +1,139 @@
+// softraster.hpp
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "renderbackend.hpp"
+#include "vertex.hpp"
+
+struct IndexBuffer;
+
+// ---------- Software rasterizer ----------
+//
+// Draws the world pass on the CPU into an offscreen framebuffer, for
+// machines with no GPU (perf runs, --soft-render). Same conventions as the
+// GL path: clip space from column-major matrices, near-plane clipping,
+// depth test GL_LESS on z / w, no face culling, texture * white or flat
+// 0.7 grey, no lighting.
+//
+// Triangles are transformed, clipped and set up on the calling thread and
+// binned into 64x64 tiles. finish() then rasterizes the tiles in parallel,
+// each tile on one thread at a time and its triangles in submission order,
+// so the image doesn't depend on the thread count. Within a tile, edge
+// functions, depth and the perspective-correct 1/w, u/w, v/w are stepped
+// four pixels per SSE register (scalar elsewhere). Textures are sampled
+// nearest, repeat, from one mip level picked per triangle by its texel to
+// pixel ratio.
+
+struct SoftTextureLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned int> texels;   // RGBA8, rows as uploaded to GL
+};
+
+struct SoftTexture {
+    std::vector<SoftTextureLevel> levels;   // [0] finest
+};
+
+struct SoftFramebuffer {
+    int width = 0;
+    int height = 0;
+    int stride = 0;                     // width rounded up to 4
+    std::vector<unsigned int> color;    // RGBA8, bottom row first like glReadPixels
+    std::vector<float> depth;
+
+    // FNV-1a over the visible pixels
+    unsigned long long hash() const;
+    bool writePPM(const std::string& path) const;
+};
+
+struct SoftRasterStats {
+    int triangles = 0;     // submitted
+    int rasterized = 0;    // after clipping / rejection (clipped pieces count once each)
+    int binned = 0;        // triangle-tile pairs
+};
+
+struct SoftRasterizer {
+    SoftFramebuffer target;
+    SoftRasterStats stats;
+
+    ~SoftRasterizer();
+
+    // threads: tiles rasterized in parallel, 0 = one per core
+    void resize(int width, int height, int threads);
+    int threadCount() const { return static_cast<int>(workers.size()) + 1; }
+
+    // clears colour and depth, drops what was binned; starts a frame's stats
+    void clear(unsigned int rgba);
+
+    // the triangle list, positions through clip = mvp * p; texture null =
+    // flat `color` (RGBA8)
+    void drawIndexed(const std::vector<Vertex>& vertices, const IndexBuffer& indices,
+        const float mvp[16], const SoftTexture* texture, unsigned int color);
+
+    // rasterizes everything binned since clear()
+    void finish();
+
+private:
+    // set up in screen space; attributes are planes, value = c + x dx + y dy
+    struct Triangle {
+        float ea[3], eb[3], ec[3];      // edge k: ea x + eb y + ec >= 0 inside
+        float zx, zy, zc;               // z / w
+        float wx, wy, wc;               // 1 / w
+        float ux, uy, uc;               // u / w
+        float vx, vy, vc;               // v / w
+        int x0, y0, x1, y1;             // pixel bounds, clamped to the target
+        const SoftTextureLevel* texture;
+        unsigned int color;
+    };
+
+    void setupTriangle(const float v[3][6], const SoftTexture* texture,
+        unsigned int color);
+    void rasterizeTile(int tile);
+    void rasterizeTiles();
+    void workerLoop(unsigned int seen);   // seen: the generation at start
+
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<unsigned int>> bins;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<float> clipVerts;       // per drawIndexed call, x y z w
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    unsigned int generation = 0;
+    int busy = 0;
+    bool stopping = false;
+    std::atomic<int> nextTile{ 0 };
+};
+
+// ---------- Software backend ----------
+
+// RenderBackend on a SoftRasterizer. Textures are looked up by
+// texturePath() and decoded on first use; ones that fail draw in the grey
+// GL shows while a texture loads.
+struct SoftwareBackend : RenderBackend {
+    SoftRasterizer raster;
+
+    void beginFrame(const float view[16], const float projection[16]) override;
+    void drawMesh(const Mesh& mesh, unsigned int texId,
+        const InstanceTransform& t) override;
+    void drawModel(const Model& model, int lod,
+        const InstanceTransform& t) override;
+    void endFrame() override;
+
+private:
+    const SoftTexture* textureFor(unsigned int texId);
+    void draw(const std::vector<Vertex>& vertices, const IndexBuffer& indices,
+        unsigned int texId, const InstanceTransform& t);
+
+    float viewProjection[16];
+    std::unordered_map<unsigned int, SoftTexture> textures;
+};
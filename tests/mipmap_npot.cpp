@@ -0,0 +1,44 @@
+// tests/mipmap_npot.cpp
+//
+// Regression check for texture streaming on images that aren't a power of
+// two: a chain trimmed with dropFinestLevels must still know the full
+// image's size, and trimming at the size of a level must keep that level
+// (otherwise streaming re-requests it every frame).
+
+#include "mipmap.hpp"
+
+#include <cstdio>
+#include <vector>
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        printf("mipmap_npot: FAILED, %s\n", what);
+        failures++;
+    }
+}
+
+int main() {
+    const int W = 1000, H = 600, CH = 4;
+    std::vector<unsigned char> pixels(static_cast<size_t>(W) * H * CH, 128);
+
+    MipChain full;
+    buildMipChain(pixels.data(), W, H, CH, full);
+    expect(full.fullSide == 1000, "fullSide of the untrimmed chain");
+
+    MipChain chain = full;
+    dropFinestLevels(chain, 256);
+    expect(chain.largestSide() == 250, "1000px trimmed at 256 keeps the 250 level");
+    expect(chain.firstLevel == 2, "1000px trimmed at 256 starts at level 2");
+    expect(chain.fullSide == 1000, "fullSide survives dropFinestLevels");
+
+    // asking again for what is resident must not change anything
+    MipChain again = full;
+    dropFinestLevels(again, chain.largestSide());
+    expect(again.firstLevel == chain.firstLevel, "trimming at a level's own size keeps it");
+
+    if (failures) return 1;
+    printf("mipmap_npot: ok\n");
+    return 0;
+}
@@ -0,0 +1,38 @@
+// tests/softraster_workers.cpp
+//
+// Regression check for SoftRasterizer's worker start-up: finish() straight
+// after resize(), before the new threads have run, must still return.
+// A watchdog fails the run instead of letting it hang.
+
+#include "softraster.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+int main() {
+    const int ROUNDS = 2000;
+    std::atomic<int> round{ 0 };
+
+    std::thread watchdog([&] {
+        std::this_thread::sleep_for(std::chrono::seconds(60));
+        printf("softraster_workers: FAILED, finish() hung in round %d of %d\n",
+            round.load(), ROUNDS);
+        fflush(stdout);
+        std::_Exit(1);
+    });
+    watchdog.detach();
+
+    SoftRasterizer raster;
+    for (int i = 0; i < ROUNDS; ++i) {
+        round = i;
+        raster.resize(64, 64, 16);
+        raster.clear(0);
+        raster.finish();
+    }
+
+    printf("softraster_workers: ok, %d rounds\n", ROUNDS);
+    return 0;
+}
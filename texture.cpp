@@ -0,0 +1,575 @@
+// texture.cpp
+#include "texture.hpp"
+#include "assetpack.hpp"   // normalizeAssetPath
+#include "meshcache.hpp"   // cooked mip chains
+#include "mipmap.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <glut.h>
+#include "glcalls.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+size_t gTextureUploadBudget = 8 * 1024 * 1024;
+bool gTexturesOnGL = true;
+
+// ---------- GL upload ----------
+
+static GLenum formatForChannels(int ch) {
+    switch (ch) {
+    case 1:  return GL_LUMINANCE;
+    case 2:  return GL_LUMINANCE_ALPHA;
+    case 4:  return GL_RGBA;
+    default: return GL_RGB;
+    }
+}
+
+// uploads every level; trilinear when there is more than one
+static void uploadMipChain(unsigned int texId, const MipChain& chain) {
+    GLenum format = formatForChannels(chain.channels);
+
+    glBindTexture(GL_TEXTURE_2D, texId);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);   // RGB rows aren't 4-byte aligned
+
+    for (size_t i = 0; i < chain.levels.size(); ++i) {
+        const MipLevel& l = chain.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format,
+            l.width, l.height, 0,
+            format, GL_UNSIGNED_BYTE, l.pixels.data());
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+        chain.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // optional: wrapping
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+// ---------- Decode ----------
+
+// cooked mip chain if there is a valid one, else PNG/TGA decode + filter,
+// and cook the (full) result for next time. maxSize > 0 keeps only the
+// levels no bigger than that. Safe to call from any thread.
+static bool decodeTexture(const std::string& path, int maxSize,
+    MipChain& out, bool& fromCache) {
+    fromCache = readCookedTexture(path, out, maxSize);
+    if (fromCache) return true;
+
+    int w, h, ch;
+    unsigned char* data = stbi_load(path.c_str(), &w, &h, &ch, 0);
+    if (!data) return false;
+
+    buildMipChain(data, w, h, ch, out);
+    stbi_image_free(data);
+
+    writeCookedTexture(path, out);
+    dropFinestLevels(out, maxSize);
+    return true;
+}
+
+bool loadMipChain(const std::string& path, MipChain& out) {
+    bool fromCache = false;
+    return decodeTexture(path, 0, out, fromCache);
+}
+
+unsigned int loadTexture(const char* filename) {
+    MipChain chain;
+    bool fromCache = false;
+    if (!decodeTexture(filename, 0, chain, fromCache)) {
+        printf("Failed to load texture: %s\n", filename);
+        return 0;
+    }
+
+    unsigned int texID;
+    glGenTextures(1, &texID);
+    uploadMipChain(texID, chain);
+    return texID;
+}
+
+// ---------- Async decode ----------
+
+struct DecodeJob {
+    unsigned int texId;
+    unsigned int ticket;
+    int maxSize;            // 0 = all levels
+    std::string path;
+};
+
+struct DecodedImage {
+    unsigned int texId = 0;
+    unsigned int ticket = 0;
+    std::string path;
+    bool ok = false;
+    bool fromCache = false;
+    MipChain chain;
+};
+
+struct TextureWorkers {
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<DecodeJob> jobs;
+    std::deque<DecodedImage> done;
+    std::vector<std::thread> threads;
+    // texId -> ticket of the load that may still write into it; a finished
+    // decode whose ticket doesn't match was cancelled (the GL name may have
+    // been deleted and handed out again since)
+    std::unordered_map<unsigned int, unsigned int> pending;
+    unsigned int nextTicket = 0;
+    bool stopping = false;
+    int busy = 0;
+    int uploaded = 0;
+    int failed = 0;
+    int cooked = 0;
+
+    ~TextureWorkers() { stop(); }
+
+    void start() {
+        if (!threads.empty()) return;
+
+        int count = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+        if (count < 1) count = 1;
+        if (count > 4) count = 4;
+
+        stopping = false;
+        for (int i = 0; i < count; ++i)
+            threads.emplace_back(&TextureWorkers::run, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> l(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+        threads.clear();
+
+        done.clear();
+        jobs.clear();
+        pending.clear();
+    }
+
+    void run() {
+        for (;;) {
+            DecodeJob job;
+            {
+                std::unique_lock<std::mutex> l(lock);
+                wake.wait(l, [this] { return stopping || !jobs.empty(); });
+                if (stopping) return;
+                job = jobs.front();
+                jobs.pop_front();
+                busy++;
+            }
+
+            DecodedImage img;
+            img.texId = job.texId;
+            img.ticket = job.ticket;
+            img.path = job.path;
+            img.ok = decodeTexture(job.path, job.maxSize, img.chain, img.fromCache);
+
+            std::lock_guard<std::mutex> l(lock);
+            busy--;
+            done.push_back(std::move(img));
+        }
+    }
+};
+
+static TextureWorkers gWorkers;
+
+// registry / streamer hook, defined below; chain is null if the load failed
+static void onTextureLoaded(unsigned int texId, const MipChain* chain);
+
+// (re)loads `path` into texId; replaces a load still queued for it
+static void queueTextureLoad(unsigned int texId, const std::string& path,
+    int maxSize) {
+    {
+        std::lock_guard<std::mutex> l(gWorkers.lock);
+        gWorkers.start();
+
+        for (auto it = gWorkers.jobs.begin(); it != gWorkers.jobs.end(); ++it) {
+            if (it->texId == texId) {
+                gWorkers.jobs.erase(it);
+                break;
+            }
+        }
+
+        DecodeJob job = { texId, ++gWorkers.nextTicket, maxSize, path };
+        gWorkers.pending[texId] = job.ticket;
+        gWorkers.jobs.push_back(job);
+    }
+    gWorkers.wake.notify_one();
+}
+
+static unsigned int createTextureAsync(const std::string& path, int maxSize) {
+    if (!gTexturesOnGL) {
+        static unsigned int nextId = 0;
+        return ++nextId;
+    }
+
+    unsigned int texID;
+    glGenTextures(1, &texID);
+
+    // same grey the untextured path uses, until the real image arrives
+    static MipChain placeholder;
+    if (placeholder.levels.empty()) {
+        static const unsigned char grey[3] = { 178, 178, 178 };
+        buildMipChain(grey, 1, 1, 3, placeholder);
+    }
+    uploadMipChain(texID, placeholder);
+
+    queueTextureLoad(texID, path, maxSize);
+    return texID;
+}
+
+unsigned int loadTextureAsync(const char* filename) {
+    return createTextureAsync(filename, 0);
+}
+
+int pumpTextureUploads(size_t maxBytes) {
+    int count = 0;
+    size_t bytes = 0;
+
+    while (count == 0 || bytes < maxBytes) {
+        DecodedImage img;
+        {
+            std::lock_guard<std::mutex> l(gWorkers.lock);
+            if (gWorkers.done.empty()) break;
+            img = std::move(gWorkers.done.front());
+            gWorkers.done.pop_front();
+
+            auto it = gWorkers.pending.find(img.texId);
+            bool current = it != gWorkers.pending.end() && it->second == img.ticket;
+            if (current) gWorkers.pending.erase(it);
+            if (!current) continue;
+        }
+
+        if (!img.ok) {
+            // keep the placeholder, like loadTexture returning 0
+            printf("Failed to load texture: %s\n", img.path.c_str());
+            onTextureLoaded(img.texId, nullptr);
+            std::lock_guard<std::mutex> l(gWorkers.lock);
+            gWorkers.failed++;
+            continue;
+        }
+
+        uploadMipChain(img.texId, img.chain);
+        onTextureLoaded(img.texId, &img.chain);
+
+        bytes += img.chain.byteSize();
+        ++count;
+
+        std::lock_guard<std::mutex> l(gWorkers.lock);
+        gWorkers.uploaded++;
+        if (img.fromCache) gWorkers.cooked++;
+    }
+
+    return count;
+}
+
+TextureLoadStats textureLoadStats() {
+    std::lock_guard<std::mutex> l(gWorkers.lock);
+
+    TextureLoadStats s;
+    s.queued = static_cast<int>(gWorkers.jobs.size()) + gWorkers.busy;
+    s.decoded = static_cast<int>(gWorkers.done.size());
+    s.uploaded = gWorkers.uploaded;
+    s.failed = gWorkers.failed;
+    s.cooked = gWorkers.cooked;
+    return s;
+}
+
+// drops a queued or in-flight load so it never touches texId again
+static void cancelTextureLoad(unsigned int texId) {
+    std::lock_guard<std::mutex> l(gWorkers.lock);
+
+    if (gWorkers.pending.erase(texId) == 0) return;
+
+    for (auto it = gWorkers.jobs.begin(); it != gWorkers.jobs.end(); ++it) {
+        if (it->texId == texId) {
+            gWorkers.jobs.erase(it);
+            break;
+        }
+    }
+}
+
+void shutdownTextureWorkers() {
+    gWorkers.stop();
+}
+
+// ---------- Texture registry ----------
+//
+// Only touched from the GL thread, like the GL calls it wraps.
+
+struct TextureEntry {
+    unsigned int texId = 0;
+    int refs = 0;
+    std::string path;            // as passed to acquireTexture, for reloads
+
+    // streaming; sizes are the largest side of the finest level, in texels
+    int fullSize = 0;            // of the image itself, known after the first load
+    int residentSize = 0;        // on the GPU now (0 = placeholder)
+    size_t residentBytes = 0;
+    int loadingSize = 0;         // load in flight, 0 = none
+    bool failed = false;
+    float wantedPixels = 0.0f;   // largest projected size this frame
+    int lastUsedFrame = -1;
+};
+
+static std::unordered_map<std::string, TextureEntry> gTextureRegistry;
+static std::unordered_map<unsigned int, std::string> gTexturePaths;   // texId -> key
+static TextureCacheStats gTextureCacheStats;
+
+static const int STREAM_INITIAL_SIZE = 256;   // first load of a registry texture
+static const int STREAM_MIN_SIZE = 64;        // eviction never goes below this
+static const int STREAM_MAX_REQUESTS = 4;     // new loads started per frame
+
+size_t gTextureResidentBudget = 128 * 1024 * 1024;
+
+static int gStreamFrame = 0;
+static int gStreamUpgrades = 0;
+static int gStreamEvictions = 0;
+
+static TextureEntry* findTextureEntry(unsigned int texId) {
+    auto p = gTexturePaths.find(texId);
+    if (p == gTexturePaths.end()) return nullptr;
+    return &gTextureRegistry[p->second];
+}
+
+unsigned int acquireTexture(const std::string& path) {
+    std::string key = normalizeAssetPath(path);
+
+    auto it = gTextureRegistry.find(key);
+    if (it != gTextureRegistry.end()) {
+        gTextureCacheStats.hits++;
+        it->second.refs++;
+        return it->second.texId;
+    }
+
+    gTextureCacheStats.misses++;
+
+    TextureEntry e;
+    e.texId = createTextureAsync(path, STREAM_INITIAL_SIZE);
+    e.refs = 1;
+    e.path = path;
+    e.loadingSize = STREAM_INITIAL_SIZE;
+    gTextureRegistry[key] = e;
+    gTexturePaths[e.texId] = key;
+    return e.texId;
+}
+
+void releaseTexture(unsigned int texId) {
+    auto p = gTexturePaths.find(texId);
+    if (p == gTexturePaths.end()) return;   // 0 or not from acquireTexture
+
+    auto it = gTextureRegistry.find(p->second);
+    if (--it->second.refs > 0) return;
+
+    cancelTextureLoad(texId);
+    if (gTexturesOnGL) glDeleteTextures(1, &texId);
+
+    gTextureRegistry.erase(it);
+    gTexturePaths.erase(p);
+    gTextureCacheStats.freed++;
+}
+
+std::string texturePath(unsigned int texId) {
+    TextureEntry* e = findTextureEntry(texId);
+    return e ? e->path : std::string();
+}
+
+TextureCacheStats textureCacheStats() {
+    TextureCacheStats s = gTextureCacheStats;
+    s.live = static_cast<int>(gTextureRegistry.size());
+    return s;
+}
+
+// ---------- Texture streaming ----------
+
+static void onTextureLoaded(unsigned int texId, const MipChain* chain) {
+    TextureEntry* e = findTextureEntry(texId);
+    if (!e) return;   // plain loadTextureAsync texture
+
+    e->loadingSize = 0;
+    if (!chain) {
+        e->failed = true;
+        return;
+    }
+
+    e->residentSize = chain->largestSide();
+    e->fullSize = chain->fullSide;
+    e->residentBytes = chain->byteSize();
+}
+
+void noteTextureUse(unsigned int texId, float eyeDistance, float eyeRadius,
+    float screenScale) {
+    TextureEntry* e = findTextureEntry(texId);
+    if (!e) return;
+
+    float r = eyeRadius;
+    if (eyeDistance + r <= 0.0f) return;   // entirely behind the camera
+
+    // diameter projected at the nearest point of the bounding sphere;
+    // camera inside it means every texel may be on screen
+    float nearDist = eyeDistance - r;
+    float pixels = nearDist > 0.01f
+        ? r * screenScale / nearDist
+        : 1e9f;
+
+    e->wantedPixels = std::max(e->wantedPixels, pixels);
+    e->lastUsedFrame = gStreamFrame;
+}
+
+// largest side of the level dropFinestLevels keeps for a load at this size;
+// sides halve with floor, so for images that aren't a power of two this is
+// below the size asked for (1000 at 256 gives 250)
+static int levelSizeFor(const TextureEntry& e, int size) {
+    int side = e.fullSize;
+    while (side > size && side > 1) side /= 2;
+    return side;
+}
+
+// level covering (up to rounding) this frame's projected size; unused
+// textures only need the minimum
+static int wantedSizeOf(const TextureEntry& e) {
+    int size = STREAM_MIN_SIZE;
+    if (e.lastUsedFrame == gStreamFrame) {
+        while (size < e.wantedPixels && size < e.fullSize) size *= 2;
+    }
+    return levelSizeFor(e, size);
+}
+
+// mip chain bytes scale with the square of the top level
+static size_t bytesAtSize(const TextureEntry& e, int size) {
+    if (e.residentSize <= 0) return 0;
+    double ratio = static_cast<double>(size) / e.residentSize;
+    return static_cast<size_t>(e.residentBytes * ratio * ratio);
+}
+
+static void requestTextureSize(TextureEntry& e, int size) {
+    e.loadingSize = size;
+    queueTextureLoad(e.texId, e.path, size);
+}
+
+void updateTextureStreaming() {
+    size_t total = 0;
+    std::vector<TextureEntry*> upgrades, evictable;
+
+    for (auto& kv : gTextureRegistry) {
+        TextureEntry& e = kv.second;
+
+        // loads in flight count at the size they will have
+        total += e.loadingSize ? std::max(e.residentBytes, bytesAtSize(e, e.loadingSize))
+                               : e.residentBytes;
+
+        if (e.failed || e.residentSize == 0 || e.loadingSize != 0) continue;
+
+        int want = wantedSizeOf(e);
+        if (want > e.residentSize)
+            upgrades.push_back(&e);
+        else if (e.residentSize > levelSizeFor(e, std::max(want, STREAM_MIN_SIZE)))
+            evictable.push_back(&e);
+    }
+
+    // biggest shortfall first
+    std::sort(upgrades.begin(), upgrades.end(),
+        [](const TextureEntry* a, const TextureEntry* b) {
+            return wantedSizeOf(*a) / a->residentSize > wantedSizeOf(*b) / b->residentSize;
+        });
+    // least recently used first, then largest
+    std::sort(evictable.begin(), evictable.end(),
+        [](const TextureEntry* a, const TextureEntry* b) {
+            if (a->lastUsedFrame != b->lastUsedFrame) return a->lastUsedFrame < b->lastUsedFrame;
+            return a->residentBytes > b->residentBytes;
+        });
+
+    int requests = 0;
+    size_t nextVictim = 0;
+
+    auto evictOne = [&]() {
+        TextureEntry* v = evictable[nextVictim++];
+        int target = levelSizeFor(*v, std::max(wantedSizeOf(*v), STREAM_MIN_SIZE));
+        total -= v->residentBytes - bytesAtSize(*v, target);
+        requestTextureSize(*v, target);
+        gStreamEvictions++;
+        requests++;
+    };
+
+    for (TextureEntry* e : upgrades) {
+        if (requests >= STREAM_MAX_REQUESTS) break;
+
+        int want = wantedSizeOf(*e);
+        size_t extra = bytesAtSize(*e, want) - e->residentBytes;
+
+        while (total + extra > gTextureResidentBudget &&
+            nextVictim < evictable.size() && requests < STREAM_MAX_REQUESTS)
+            evictOne();
+
+        if (total + extra > gTextureResidentBudget || requests >= STREAM_MAX_REQUESTS)
+            continue;   // no room (yet); a smaller one may still fit
+
+        total += extra;
+        requestTextureSize(*e, want);
+        gStreamUpgrades++;
+        requests++;
+    }
+
+    // budget lowered or too much in use: keep shrinking what's least needed
+    while (total > gTextureResidentBudget &&
+        nextVictim < evictable.size() && requests < STREAM_MAX_REQUESTS)
+        evictOne();
+
+    // still over: halve the biggest textures even though they're on screen
+    // (they only come back up once there is room again)
+    if (total > gTextureResidentBudget) {
+        std::vector<TextureEntry*> squeeze;
+        for (auto& kv : gTextureRegistry) {
+            TextureEntry& e = kv.second;
+            if (!e.failed && e.loadingSize == 0 && e.residentSize > STREAM_MIN_SIZE)
+                squeeze.push_back(&e);
+        }
+        std::sort(squeeze.begin(), squeeze.end(),
+            [](const TextureEntry* a, const TextureEntry* b) {
+                return a->residentBytes > b->residentBytes;
+            });
+
+        for (size_t i = 0; i < squeeze.size() && total > gTextureResidentBudget &&
+            requests < STREAM_MAX_REQUESTS; ++i) {
+            TextureEntry* v = squeeze[i];
+            int target = v->residentSize / 2;
+            total -= v->residentBytes - bytesAtSize(*v, target);
+            requestTextureSize(*v, target);
+            gStreamEvictions++;
+            requests++;
+        }
+    }
+
+    for (auto& kv : gTextureRegistry)
+        kv.second.wantedPixels = 0.0f;
+    gStreamFrame++;
+}
+
+TextureStreamStats textureStreamStats() {
+    TextureStreamStats s;
+    s.budgetBytes = gTextureResidentBudget;
+    s.upgrades = gStreamUpgrades;
+    s.evictions = gStreamEvictions;
+
+    for (const auto& kv : gTextureRegistry) {
+        s.residentBytes += kv.second.residentBytes;
+        s.textures++;
+        if (kv.second.loadingSize) s.streaming++;
+    }
+    return s;
+}
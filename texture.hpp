@@ -0,0 +1,109 @@
+// texture.hpp
+#pragma once
+#include <cstddef>
+#include <string>
+
+struct MipChain;
+
+// ---------- Texture loading ----------
+//
+// loadTexture decodes (stb_image) and uploads on the calling thread.
+// Either way the image gets a full mip chain (mipmap.hpp) and trilinear
+// filtering, and the decoded chain is cooked next to the source
+// ("<image>.cooked", see meshcache.hpp) so later launches skip the PNG
+// decode and the filtering.
+//
+// loadTextureAsync returns a GL texture name right away that holds a 1x1
+// grey placeholder; the file is decoded on a worker thread and the real
+// image is uploaded into the same texture name later by pumpTextureUploads,
+// which must run on the GL thread (Display() calls it once per frame).
+// Materials can keep the id they got at load time.
+
+unsigned int loadTexture(const char* filename);
+unsigned int loadTextureAsync(const char* filename);
+
+// Uploads finished decodes until `maxBytes` of pixel data went to GL in this
+// call (always at least one, so a texture bigger than the budget still gets
+// through). Returns the number of textures uploaded.
+int pumpTextureUploads(size_t maxBytes);
+
+// per-frame upload budget used by Display(); --tex-budget-kb overrides it
+extern size_t gTextureUploadBudget;
+
+struct TextureLoadStats {
+    int queued = 0;      // waiting for / being decoded by a worker
+    int decoded = 0;     // decoded, waiting for upload
+    int uploaded = 0;    // total uploads so far
+    int failed = 0;
+    int cooked = 0;      // uploads that came from a cooked mip chain
+};
+
+TextureLoadStats textureLoadStats();
+
+// worker count is picked on the first async load (cores - 1, at least 1)
+void shutdownTextureWorkers();
+
+// The full mip chain of an image file (cooked copy if valid), for use on
+// the CPU; any thread.
+bool loadMipChain(const std::string& path, MipChain& out);
+
+// false when assets are loaded without a GL context (the software
+// renderer): acquireTexture still hands out ids and remembers their paths,
+// but creates, loads and uploads nothing
+extern bool gTexturesOnGL;
+
+// ---------- Texture registry ----------
+//
+// Shared textures keyed by normalized path ('\\' -> '/', "." / ".." folded,
+// case-insensitive on Windows). acquireTexture returns the existing GL name
+// for a path it has seen before and bumps its reference count, otherwise it
+// starts an async load. releaseTexture drops one reference and deletes the
+// GL texture when none are left.
+
+unsigned int acquireTexture(const std::string& path);
+void releaseTexture(unsigned int texId);
+
+// the path an acquireTexture id was loaded from, "" if none
+std::string texturePath(unsigned int texId);
+
+struct TextureCacheStats {
+    int hits = 0;        // acquire found the path already loaded
+    int misses = 0;      // acquire had to start a load
+    int live = 0;        // textures currently held
+    int freed = 0;       // textures deleted after their last release
+};
+
+TextureCacheStats textureCacheStats();
+
+// ---------- Texture streaming ----------
+//
+// Registry textures first load with levels up to 256 texels. Each draw
+// that binds one reports how big the object is on screen (noteTextureUse,
+// from the caller's own matrices), and updateTextureStreaming (once per
+// frame, after the world is drawn) reloads finer levels for textures that
+// are too coarse, and coarser ones for textures that hold more than they
+// need, keeping the bytes of all resident mip chains under
+// gTextureResidentBudget. GL 1.1 has no base level, so a
+// resident subset is re-specified as levels 0..n; the cooked file lets the
+// worker read just those levels.
+
+// eyeDistance: of the object's centre in front of the camera; eyeRadius:
+// its bounding sphere, in eye units; screenScale: projection[5] times the
+// viewport height in pixels
+void noteTextureUse(unsigned int texId, float eyeDistance, float eyeRadius,
+    float screenScale);
+void updateTextureStreaming();
+
+// --tex-resident-mb overrides it
+extern size_t gTextureResidentBudget;
+
+struct TextureStreamStats {
+    size_t residentBytes = 0;
+    size_t budgetBytes = 0;
+    int textures = 0;
+    int streaming = 0;     // reloads in flight
+    int upgrades = 0;      // totals since start
+    int evictions = 0;
+};
+
+TextureStreamStats textureStreamStats();
@@ -0,0 +1,13 @@
+// vertex.hpp
+#pragma once
+
+// Storage format of Mesh and SubMesh: position, normal and texcoord
+// interleaved in one 32-byte record, so a vertex is one fetch and a whole
+// mesh uploads as one buffer. GL reads it with stride sizeof(Vertex).
+struct Vertex {
+    float px, py, pz;
+    float nx, ny, nz;
+    float u, v;
+};
+
+static_assert(sizeof(Vertex) == 32, "Vertex must stay 8 packed floats");